@@ -0,0 +1,58 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//
+// Measures the number of command lines per second handled by `Program::parse`
+// with and without the cache of parse results, for a command line seen over
+// and over again.
+//
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <option/Program.hh>
+
+using namespace kuri;
+using clock_type = std::chrono::steady_clock;
+
+double measure(std::size_t capacity)
+{
+  constexpr int iterations = 200000;
+  option::Program program("cache");
+  for(int i = 0; i < 30; ++i)
+    program.optional(fmt::format("--flag-{}", i), []() {});
+  program.required("--threads", [](const option::Option&) {})
+    .check("--threads", [](std::string_view v) { return v.find_first_not_of("0123456789") == v.npos; })
+    .optional("--output", [](const option::Option&) {})
+    .abbreviations()
+    .args(1, {})
+    .cache(capacity);
+  option::args_t args{"--flag-3", "--threads", "8", "--output=out.txt", "--flag-17", "--flag-2", "input1", "input2"};
+  auto start = clock_type::now();
+  for(int i = 0; i < iterations; ++i)
+    program.parse(args.begin(), args.end());
+  return iterations / std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+int main()
+{
+  std::cout << fmt::format("uncached: {:.0f} lines per second\n", measure(0));
+  std::cout << fmt::format("cached:   {:.0f} lines per second\n", measure(256));
+  return 0;
+}
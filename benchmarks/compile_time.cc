@@ -0,0 +1,52 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//
+// A typical translation unit using the library, compiled repeatedly by
+// compile_time.sh to measure the cost of including the headers.  With
+// COMPILE_TIME_FORWARD defined it only declares a function taking a
+// `Program`, which is all many translation units of a large program do.
+//
+
+#ifdef COMPILE_TIME_FORWARD
+
+#include <option/forward.hh>
+
+void configure(kuri::option::Program& program);
+
+#else
+
+#include <string>
+
+#include <option/Program.hh>
+
+using namespace kuri;
+
+void configure(option::Program& program)
+{
+  program.optional("--verbose", []() {})
+    .required("--output", [](const option::Option&) {})
+    .args(0, {});
+}
+
+int run(option::args_t& args)
+{
+  option::Program program("compile_time");
+  configure(program);
+  auto rest = program.parse(args.begin(), args.end());
+  return static_cast<int>(std::distance(rest, args.end()));
+}
+
+#endif
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Copyright 2026 Krister Joas
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+
+#
+# Measures the time to compile a typical translation unit using the library:
+# header-only, with the compiled library, and with only the forward
+# declarations.
+#
+# usage: compile_time.sh <compiler> <iterations> <flags>...
+#
+# The flags must include the include directories of the library and of fmt.
+#
+
+set -e
+compiler=$1
+iterations=$2
+shift 2
+source=$(dirname "$0")/compile_time.cc
+object=${TMPDIR:-/tmp}/compile_time.$$.o
+trap 'rm -f "$object"' EXIT
+
+measure()
+{
+  start=$(date +%s%N)
+  i=0
+  while [ $i -lt "$iterations" ]; do
+    "$compiler" -std=c++17 "$@" -c "$source" -o "$object"
+    i=$((i + 1))
+  done
+  end=$(date +%s%N)
+  echo $(((end - start) / iterations / 1000000)) ms $(wc -c < "$object") bytes
+}
+
+echo "header-only: $(measure "$@")"
+echo "compiled:    $(measure -DKURI_OPTION_COMPILED "$@")"
+echo "forward:     $(measure -DCOMPILE_TIME_FORWARD "$@")"
@@ -0,0 +1,111 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Measures the latency of a shell completion request.  Run without arguments
+// the program runs itself in completion mode the way the shell completion
+// scripts do and reports the mean time per request, including starting the
+// process.  It also reports the time spent in `Program::complete` alone.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include <option/Program.hh>
+#include <option/completion.hh>
+
+extern char** environ;
+
+using namespace kuri;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+constexpr int options = 200;
+constexpr int processes = 200;
+constexpr int iterations = 100000;
+
+option::Program make_program()
+{
+  option::Program program("completion");
+  for(int i = 0; i < options; ++i)
+    program.optional(fmt::format("--option-{:03}", i), []() {});
+  return program;
+}
+
+double spawn(const char* self, const std::vector<std::string>& words)
+{
+  std::vector<char*> argv{const_cast<char*>(self)};
+  for(auto& w: words)
+    argv.push_back(const_cast<char*>(w.c_str()));
+  argv.push_back(nullptr);
+  std::vector<char*> env;
+  for(char** e = environ; *e != nullptr; ++e)
+    env.push_back(*e);
+  std::string complete = std::string(option::completion_variable) + "=1";
+  env.push_back(complete.data());
+  env.push_back(nullptr);
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  auto start = clock_type::now();
+  double total = 0;
+  for(int i = 0; i < processes; ++i)
+  {
+    pid_t pid;
+    if(posix_spawn(&pid, self, &actions, nullptr, argv.data(), env.data()) != 0)
+    {
+      std::cerr << "posix_spawn failed\n";
+      std::exit(1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+  }
+  total = std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+  posix_spawn_file_actions_destroy(&actions);
+  return total / processes;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+  auto program = make_program();
+  option::args_t args{argv + 1, argv + argc};
+  if(option::completion_requested())
+  {
+    for(auto& c: program.complete(args.begin(), args.end()))
+      std::cout << c << '\n';
+    return 0;
+  }
+  std::vector<std::string> words{"--option-001", "--option-1"};
+  std::cout << fmt::format("end to end: {:.1f} us per request\n", spawn(argv[0], words));
+  std::size_t n = 0;
+  auto start = clock_type::now();
+  for(int i = 0; i < iterations; ++i)
+    n += program.complete(words.begin(), words.end()).size();
+  auto elapsed = std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+  std::cout << fmt::format("in process: {:.2f} us per request ({} candidates)\n", elapsed / iterations,
+    n / iterations);
+  return 0;
+}
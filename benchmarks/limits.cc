@@ -0,0 +1,99 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//
+// Measures the time per input byte of `Program::parse` for inputs crafted to
+// be expensive, at growing input sizes.  The time per byte stays about the
+// same as the size grows when the work is linear in the size of the input.
+// The last column is the time to reject the largest input when the limits
+// are set below its size.
+//
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <option/Program.hh>
+
+using namespace kuri;
+using clock_type = std::chrono::steady_clock;
+
+option::Program make_program(const option::Program::limits_t& limits = {})
+{
+  option::Program program("limits");
+  for(int i = 0; i < 30; ++i)
+    program.optional(fmt::format("--flag-{}", i), []() {});
+  program.optional("--output", [](const option::Option&) {})
+    .optional("--ranges",
+      [size = limits.range_size](const option::Option& o) { option::numeric_range(o.value, 0, 1 << 30, size); })
+    .abbreviations()
+    .args(0, {})
+    .limits(limits);
+  return program;
+}
+
+// Parses the arguments, which may be rejected, and returns the time taken in
+// seconds.
+double measure(option::Program& program, option::args_t& args)
+{
+  auto start = clock_type::now();
+  try
+  {
+    program.parse(args.begin(), args.end());
+  }
+  catch(const std::exception&)
+  {}
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+int main()
+{
+  const std::vector<std::size_t> sizes{10000, 100000, 1000000};
+  // Each function returns arguments of about the given size in bytes.
+  const std::vector<std::pair<const char*, std::function<option::args_t(std::size_t)>>> inputs{
+    {"many options", [](std::size_t n) { return option::args_t(n / 8, "--flag-1"); }},
+    {"many arguments", [](std::size_t n) { return option::args_t(n, "x"); }},
+    {"long value", [](std::size_t n) { return option::args_t{"--output=" + std::string(n, 'x')}; }},
+    {"unknown option", [](std::size_t n) { return option::args_t{"--" + std::string(n, 'f')}; }},
+    {"ambiguous prefix", [](std::size_t n) { return option::args_t(n / 8, "--fla"); }},
+    {"many ranges", [](std::size_t n) {
+       std::string ranges;
+       while(ranges.size() < n)
+         ranges += "0-99,";
+       return option::args_t{"--ranges=" + ranges};
+     }}};
+  std::cout << fmt::format("{:<18}", "ns per byte");
+  for(auto size: sizes)
+    std::cout << fmt::format("{:>10}", size);
+  std::cout << fmt::format("{:>12}\n", "rejected");
+  for(auto& [name, input]: inputs)
+  {
+    std::cout << fmt::format("{:<18}", name);
+    for(auto size: sizes)
+    {
+      auto program = make_program();
+      auto args = input(size);
+      std::cout << fmt::format("{:>10.2f}", measure(program, args) * 1e9 / static_cast<double>(size));
+    }
+    auto program = make_program({1000, 1000, 1000, 1000});
+    auto args = input(sizes.back());
+    std::cout << fmt::format("{:>10.0f}us\n", measure(program, args) * 1e6);
+  }
+  return 0;
+}
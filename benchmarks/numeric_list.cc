@@ -0,0 +1,88 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//
+// Measures the time to convert an option value holding a list of 500000
+// numbers with `numeric_list` compared to `split_string` followed by
+// `std::stoi` or `std::stod` for each element.  Most of the doubles take
+// the plain decimal path of `numeric_list`; the rest, such as
+// 0.37000000000000005, fall back to `std::from_chars`, whose speed
+// depends on the standard library.
+//
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <option/numeric_list.hh>
+#include <option/string_functions.hh>
+
+using namespace kuri;
+using clock_type = std::chrono::steady_clock;
+
+// Returns the time in milliseconds of the fastest of a few runs.
+double measure(const std::function<std::size_t()>& f)
+{
+  double best = 0;
+  for(int i = 0; i < 5; ++i)
+  {
+    auto start = clock_type::now();
+    if(f() == 0)
+      std::cerr << "empty result\n";
+    auto elapsed = std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+    best = i == 0 ? elapsed : std::min(best, elapsed);
+  }
+  return best;
+}
+
+int main()
+{
+  constexpr int size = 500000;
+  std::string ints;
+  std::string doubles;
+  for(int i = 0; i < size; ++i)
+  {
+    ints += fmt::format("{},", i * 7919LL % 1000003);
+    doubles += fmt::format("{},", i * 0.37);
+  }
+  ints.pop_back();
+  doubles.pop_back();
+
+  auto split_stoi = measure([&]() {
+    std::vector<int> result;
+    for(auto& s: option::split_string(ints, ','))
+      result.push_back(std::stoi(s));
+    return result.size();
+  });
+  auto list_int = measure([&]() { return option::numeric_list<int>(ints).size(); });
+  auto split_stod = measure([&]() {
+    std::vector<double> result;
+    for(auto& s: option::split_string(doubles, ','))
+      result.push_back(std::stod(s));
+    return result.size();
+  });
+  auto list_double = measure([&]() { return option::numeric_list<double>(doubles).size(); });
+
+  std::cout << fmt::format("int,    split_string + stoi: {:7.2f} ms\n", split_stoi);
+  std::cout << fmt::format("int,    numeric_list:        {:7.2f} ms ({:.1f}x)\n", list_int, split_stoi / list_int);
+  std::cout << fmt::format("double, split_string + stod: {:7.2f} ms\n", split_stod);
+  std::cout << fmt::format(
+    "double, numeric_list:        {:7.2f} ms ({:.1f}x)\n", list_double, split_stod / list_double);
+  return 0;
+}
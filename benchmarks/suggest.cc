@@ -0,0 +1,89 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Measures the time to find the option nearest to a misspelled option among
+// 5000 generated option names, with `Nearest` and with a plain dynamic
+// programming edit distance.  A loop doing only the length check of `Nearest`
+// shows the cost of looking at every name.  `Nearest` doesn't meet the target
+// of a few microseconds per lookup.
+//
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <option/suggest.hh>
+
+using namespace kuri;
+using clock_type = std::chrono::steady_clock;
+
+int main()
+{
+  constexpr int candidates = 5000;
+  constexpr int iterations = 1000;
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::uniform_int_distribution<int> length(4, 20);
+  std::vector<std::string> names;
+  for(int i = 0; i < candidates; ++i)
+  {
+    std::string name = "--";
+    for(int n = length(random); n > 0; --n)
+      name += static_cast<char>(letter(random));
+    names.push_back(name);
+  }
+  auto word = names[candidates / 2];
+  std::swap(word[4], word[5]);
+
+  std::string_view best;
+  auto start = clock_type::now();
+  for(int i = 0; i < iterations; ++i)
+  {
+    option::Nearest nearest(word);
+    for(auto& name: names)
+      nearest(name);
+    best = nearest.best();
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / iterations;
+  std::cout << fmt::format("Nearest:      {:.1f} us ({} -> {})\n", elapsed, word, best);
+
+  // Read the size on every iteration so the loop isn't optimized away.
+  volatile std::size_t size = word.size();
+  std::size_t near = 0;
+  start = clock_type::now();
+  for(int i = 0; i < iterations; ++i)
+  {
+    std::size_t n = size;
+    for(auto& name: names)
+      near += (name.size() > n ? name.size() - n : n - name.size()) <= 2 ? 1 : 0;
+  }
+  elapsed = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / iterations;
+  std::cout << fmt::format("length only:   {:.1f} us ({} near in length)\n", elapsed, near / iterations);
+
+  std::size_t distance = 0;
+  start = clock_type::now();
+  for(int i = 0; i < iterations / 10; ++i)
+  {
+    distance = word.size();
+    for(auto& name: names)
+      distance = std::min(distance, option::edit_distance(word, name));
+  }
+  elapsed = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / (iterations / 10);
+  std::cout << fmt::format("edit_distance: {:.1f} us (distance {})\n", elapsed, distance);
+  return 0;
+}
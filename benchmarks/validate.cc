@@ -0,0 +1,50 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Measures the number of command lines per second checked by
+// `Program::validate`.
+//
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <option/Program.hh>
+
+using namespace kuri;
+using clock_type = std::chrono::steady_clock;
+
+int main()
+{
+  constexpr int iterations = 1000000;
+  option::Program program("validate");
+  for(int i = 0; i < 20; ++i)
+    program.optional(fmt::format("--flag-{}", i), []() {});
+  program.required("--threads", [](const option::Option&) {})
+    .check("--threads", [](std::string_view v) { return v.find_first_not_of("0123456789") == v.npos; })
+    .optional("--output", [](const option::Option&) {})
+    .args(1, {});
+  option::args_t args{"--flag-3", "--threads", "8", "--output=out.txt", "--flag-17", "input1", "input2"};
+  std::size_t errors = 0;
+  auto start = clock_type::now();
+  for(int i = 0; i < iterations; ++i)
+    errors += program.validate(args.begin(), args.end()) ? 1 : 0;
+  auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+  std::cout << fmt::format("{:.0f} lines per second ({} errors)\n", iterations / elapsed, errors);
+  return 0;
+}
@@ -0,0 +1,162 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "parse_args.hh"
+
+namespace kuri::option
+{
+///
+/// @brief A stream of the arguments following the options which are pulled
+///   one at a time.
+///
+/// @details
+///   The arguments are first taken from the remaining range of the argument
+///   vector and then, optionally, from an input stream where each argument is
+///   terminated by a delimiter character.  A newline delimiter handles one
+///   file name per line and a NUL delimiter handles the output of `find
+///   -print0`.  Empty arguments read from the input stream are skipped.
+///
+///   The minimum and maximum number of arguments are checked while the
+///   arguments are pulled.  Exceeding the maximum is reported as soon as the
+///   extra argument is read and too few arguments is reported when the end of
+///   the stream is reached.  In both cases the error function is called which
+///   is expected to throw.
+///
+class ArgStream
+{
+public:
+  ///
+  /// @brief Type of the function called when the number of arguments is
+  ///   outside of the allowed range.
+  ///
+  using error_t = std::function<void()>;
+
+  ///
+  /// @brief Creates a stream of arguments taken from a range.
+  ///
+  /// @param first, last
+  ///   The range of arguments.
+  /// @param min_args, max_args
+  ///   The minimum and maximum number of arguments with the same meaning as
+  ///   in `Program::args`.
+  /// @param error
+  ///   Function called if the number of arguments is out of range.
+  ///
+  ArgStream(args_t::iterator first, args_t::iterator last, std::optional<int> min_args,
+    std::optional<int> max_args, error_t error)
+    : _first(first), _last(last), _min_args(min_args), _max_args(max_args), _error(std::move(error))
+  {}
+
+  ///
+  /// @brief Creates a stream of arguments taken first from a range and then
+  ///   from an input stream.
+  ///
+  /// @param first, last
+  ///   The range of arguments.
+  /// @param is
+  ///   The input stream to read additional arguments from.  The stream must
+  ///   outlive the `ArgStream` object.
+  /// @param delim
+  ///   The character terminating each argument in the input stream.
+  /// @param min_args, max_args
+  ///   The minimum and maximum number of arguments with the same meaning as
+  ///   in `Program::args`.
+  /// @param error
+  ///   Function called if the number of arguments is out of range.
+  ///
+  ArgStream(args_t::iterator first, args_t::iterator last, std::istream& is, char delim,
+    std::optional<int> min_args, std::optional<int> max_args, error_t error)
+    : _first(first),
+      _last(last),
+      _is(&is),
+      _delim(delim),
+      _min_args(min_args),
+      _max_args(max_args),
+      _error(std::move(error))
+  {}
+
+  ///
+  /// @brief Pull the next argument.
+  ///
+  /// @return The next argument or an empty optional at the end of the
+  ///   stream.  The returned view is valid until the next call to `next`.
+  ///
+  std::optional<std::string_view> next()
+  {
+    std::string_view arg;
+    if(_first != _last)
+      arg = *_first++;
+    else if(read())
+      arg = _buffer;
+    else
+    {
+      if(_min_args && _count < static_cast<std::size_t>(*_min_args))
+        _error();
+      return {};
+    }
+    ++_count;
+    if(!_min_args || (_max_args && _count > static_cast<std::size_t>(*_max_args)))
+      _error();
+    return arg;
+  }
+
+  ///
+  /// @brief Returns the number of arguments pulled so far.
+  ///
+  std::size_t count() const noexcept { return _count; }
+
+private:
+  ///
+  /// @brief Read the next non-empty argument from the input stream.
+  ///
+  /// @return True if an argument was read into the buffer.
+  ///
+  bool read()
+  {
+    if(_is == nullptr)
+      return false;
+    while(std::getline(*_is, _buffer, _delim))
+      if(!_buffer.empty())
+        return true;
+    return false;
+  }
+
+  /// @brief The remaining range of arguments.
+  args_t::iterator _first;
+  args_t::iterator _last;
+  /// @brief The optional input stream read after the range.
+  std::istream* _is = nullptr;
+  /// @brief The delimiter of arguments in the input stream.
+  char _delim = '\n';
+  /// @brief The buffer holding the last argument read from the stream.
+  std::string _buffer;
+  /// @brief Minimum and maximum number of arguments.
+  std::optional<int> _min_args;
+  std::optional<int> _max_args;
+  /// @brief Number of arguments pulled so far.
+  std::size_t _count = 0;
+  /// @brief Called when the number of arguments is out of range.
+  error_t _error;
+};
+
+} // namespace kuri::option
@@ -1,4 +1,4 @@
-// Copyright 2021 Krister Joas
+// Copyright 2021, 2026 Krister Joas
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -14,12 +14,30 @@
 
 #pragma once
 
+#include <algorithm>
+#include <filesystem>
 #include <functional>
+#include <istream>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <utility>
+#include <type_traits>
+#include <variant>
+#include <vector>
 
+#include "Plugin.hh"
+#include "StringPool.hh"
+#include "overloaded.hh"
+#include "parallel.hh"
 #include "parse_args.hh"
+#include "string_functions.hh"
+#include "suggest.hh"
 #include "usage.hh"
 
 namespace kuri::option
@@ -37,9 +55,14 @@ public:
   ///
   /// @param program_name
   ///   The name of the program.  This will be included in the usage string.
+  /// @param names
+  ///   The pool holding the command names.  It can be shared with the
+  ///   `Program` of each command.  By default the commands have a pool of
+  ///   their own.
   ///
-  Commands(const std::optional<std::string> program_name = {})
-    : _program_name(program_name)
+  Commands(const std::optional<std::string> program_name = {}, std::shared_ptr<StringPool> names = {})
+    : _names(names ? std::move(names) : std::make_shared<StringPool>()),
+      _program_name(program_name)
   {
   }
   ///
@@ -56,6 +79,14 @@ public:
   ///   The range of command line arguments to parse.
   ///
   using function_t = std::function<void(Context& context, args_t::iterator first, args_t::iterator last)>;
+  ///
+  /// @brief Type of the callback function of a command which doesn't need
+  ///   the context.
+  ///
+  /// @param first, last
+  ///   The range of command line arguments to parse.
+  ///
+  using simple_t = std::function<void(args_t::iterator first, args_t::iterator last)>;
 
   ///
   /// @brief Registers a command string and a callback function.
@@ -67,11 +98,182 @@ public:
   ///
   Commands& command(const std::string& name, function_t callback)
   {
-    _command_list.push_back(_program_name ? cat(*_program_name, name) : name);
-    _commands.emplace(name, callback);
+    return add(name, std::move(callback));
+  }
+
+  ///
+  /// @brief Registers a command which doesn't need the context.
+  ///
+  /// @details
+  ///   When parsing with a context factory the context is not created if
+  ///   the selected command doesn't need it.  Typical examples are `help` and
+  ///   `version` commands.
+  ///
+  /// @param name
+  ///   The name of the command.
+  /// @param callback
+  ///   The callback function which is called when dispatching a command.
+  ///
+  Commands& command(const std::string& name, simple_t callback)
+  {
+    return add(name, std::move(callback));
+  }
+
+  ///
+  /// @brief Registers a command with its own type of context.
+  ///
+  /// @details
+  ///   The context is created by calling the factory when the command is
+  ///   dispatched and is destroyed when the callback returns.  To the
+  ///   `Commands` object this is a command which doesn't need the shared
+  ///   context.
+  ///
+  /// @tparam Factory
+  ///   A function taking no arguments and returning the context.
+  /// @tparam F
+  ///   A function taking a reference to the context and the range of
+  ///   arguments.
+  /// @param name
+  ///   The name of the command.
+  /// @param factory
+  ///   Creates the context of the command.
+  /// @param callback
+  ///   The callback function which is called when dispatching a command.
+  ///
+  template<typename Factory, typename F>
+  Commands& command(const std::string& name, Factory factory, F callback)
+  {
+    return add(name, simple_t([factory, callback](args_t::iterator first, args_t::iterator last) mutable {
+      auto context = factory();
+      callback(context, first, last);
+    }));
+  }
+
+  ///
+  /// @brief Type of the function implementing a command in a plugin.
+  ///
+  /// @details
+  ///   The plugin defines the function with C linkage so the name of the
+  ///   symbol is not mangled.  Both the plugin and the program must be built
+  ///   with the same definition of `Context`.
+  ///
+  /// @code
+  ///   extern "C" void attach(Context& context, args_t::iterator first, args_t::iterator last);
+  /// @endcode
+  ///
+  using plugin_t = void(Context& context, args_t::iterator first, args_t::iterator last);
+
+  ///
+  /// @brief Registers a command implemented by a function in a shared
+  ///   library.
+  ///
+  /// @details
+  ///   The library is loaded the first time the command is dispatched.
+  ///   Failing to load the library or to find the function throws
+  ///   `std::runtime_error` at that point, and loading is tried again the
+  ///   next time the command is dispatched.
+  ///
+  /// @param name
+  ///   The name of the command.
+  /// @param library
+  ///   The path of the shared library.
+  /// @param symbol
+  ///   The name of the function implementing the command.
+  ///
+  Commands& plugin(const std::string& name, const std::filesystem::path& library, const std::string& symbol)
+  {
+    struct loader_t
+    {
+      std::once_flag once;
+      std::unique_ptr<Plugin> plugin;
+      plugin_t* function = nullptr;
+    };
+    auto loader = std::make_shared<loader_t>();
+    auto dispatch = [loader, library, symbol](Context& context, args_t::iterator first, args_t::iterator last) {
+      std::call_once(loader->once, [&]() {
+        auto plugin = std::make_unique<Plugin>(library);
+        loader->function = plugin->symbol<plugin_t>(symbol);
+        loader->plugin = std::move(plugin);
+      });
+      loader->function(context, first, last);
+    };
+    return add(name, function_t(dispatch));
+  }
+
+  ///
+  /// @brief Registers the commands described by a plugin manifest.
+  ///
+  /// @details
+  ///   See `Plugin::manifest` for the format of the manifest.  The commands
+  ///   are added to the usage message in the order they appear in the
+  ///   manifest.  No library is loaded until its command is dispatched.
+  ///
+  /// @param manifest
+  ///   The path of the manifest.
+  /// @throws std::system_error if the manifest can't be read.
+  /// @throws std::runtime_error if a line of the manifest is malformed.
+  ///
+  Commands& plugins(const std::filesystem::path& manifest)
+  {
+    for(auto& entry: Plugin::manifest(manifest))
+      plugin(entry.name, entry.library, entry.symbol);
+    return *this;
+  }
+
+  ///
+  /// @brief Type of the function returning completion candidates for the
+  ///   arguments of a command.
+  ///
+  /// @param first, last
+  ///   The words after the command up to and including the word being
+  ///   completed.
+  ///
+  using completer_t = std::function<std::vector<std::string>(args_t::iterator first, args_t::iterator last)>;
+
+  ///
+  /// @brief Registers a function returning completion candidates for the
+  ///   arguments of a command.  Typically this calls `Program::complete`.
+  ///
+  /// @param name
+  ///   The name of the command.
+  /// @param completer
+  ///   The function returning the candidates.
+  ///
+  Commands& completer(const std::string& name, completer_t completer)
+  {
+    _completers.insert_or_assign(_names->intern(name), std::move(completer));
     return *this;
   }
 
+  ///
+  /// @brief Returns the completion candidates for a partial command line.
+  ///
+  /// @details
+  ///   If the range contains only the word being completed the candidates
+  ///   are the command names starting with that word.  Otherwise the
+  ///   completer registered for the command, if any, is called with the
+  ///   remaining words.  No command callbacks are executed.
+  ///
+  /// @param first, last
+  ///   The words of the command line up to and including the word being
+  ///   completed.
+  /// @return The candidates.
+  ///
+  std::vector<std::string> complete(args_t::iterator first, args_t::iterator last) const
+  {
+    std::vector<std::string> candidates;
+    if(std::distance(first, last) > 1)
+    {
+      if(auto c = _completers.find(*first); c != _completers.end())
+        return c->second(first + 1, last);
+      return candidates;
+    }
+    std::string_view word = first == last ? std::string_view() : std::string_view(*first);
+    for(auto c = _commands.lower_bound(word); c != _commands.end() && starts_with(c->first, word); ++c)
+      candidates.emplace_back(c->first);
+    return candidates;
+  }
+
   ///
   /// @brief Parse the arguments.
   ///
@@ -81,28 +283,314 @@ public:
   ///   The range of arguments to parse.
   ///
   void parse(Context& context, args_t::iterator first, args_t::iterator last)
+  {
+    parse([&context]() -> Context& { return context; }, first, last);
+  }
+
+  ///
+  /// @brief Parse the arguments and create the context only if the selected
+  ///   command needs it.
+  ///
+  /// @details
+  ///   The command is looked up first.  If the command was registered with a
+  ///   callback taking the context the factory is called to create the
+  ///   context, which is passed to the callback and destroyed when it
+  ///   returns.  Unknown commands are reported without creating the context.
+  ///
+  /// @tparam Factory
+  ///   A function taking no arguments and returning a `Context` or a
+  ///   reference to one.
+  /// @param factory
+  ///   Creates the context.
+  /// @param first, last
+  ///   The range of arguments to parse.
+  ///
+  template<typename Factory, typename = std::enable_if_t<std::is_invocable_v<Factory>>>
+  void parse(Factory factory, args_t::iterator first, args_t::iterator last)
   {
     if(first == last)
       usage();
-    auto c = _commands.find(*first);
-    if(c == _commands.end())
-      usage();
-    c->second(context, first + 1, last);
+    auto& callback = lookup(first);
+    // clang-format off
+    std::visit(
+      overloaded{
+        [&](const function_t& f) {
+          decltype(auto) context = factory();
+          f(context, first + 1, last);
+        },
+        [&](const simple_t& f) { f(first + 1, last); }},
+      callback);
+    // clang-format on
+  }
+
+  ///
+  /// @brief Type of the function checking the arguments of a command before
+  ///   a batch is executed.
+  ///
+  /// @param first, last
+  ///   The arguments after the command.
+  /// @return An error message, or nothing if the arguments are valid.
+  ///
+  using validator_t = std::function<std::optional<std::string>(args_t::iterator first, args_t::iterator last)>;
+
+  ///
+  /// @brief Registers a function checking the arguments of a command without
+  ///   executing it.  Typically this calls `Program::validate`.
+  ///
+  /// @param name
+  ///   The name of the command.
+  /// @param validator
+  ///   The function checking the arguments.
+  ///
+  Commands& validator(const std::string& name, validator_t validator)
+  {
+    _validators.insert_or_assign(_names->intern(name), std::move(validator));
+    return *this;
+  }
+
+  ///
+  /// @brief Parse and execute a batch of commands separated by a separator
+  ///   word.
+  ///
+  /// @details
+  ///   All commands are looked up, and their arguments checked by the
+  ///   validator registered for the command, if any, before any command is
+  ///   executed.  The context is created once, and only if at least one of
+  ///   the commands needs it.  Empty commands are ignored.
+  ///
+  /// @code
+  ///   tool create a ";" attach a b ";" start a
+  /// @endcode
+  ///
+  /// @tparam Factory
+  ///   A function taking no arguments and returning a `Context` or a
+  ///   reference to one.
+  /// @param factory
+  ///   Creates the context.
+  /// @param first, last
+  ///   The range of arguments to parse.
+  /// @param separator
+  ///   The word separating the commands.
+  /// @param concurrency
+  ///   The maximum number of commands executed concurrently.  One means the
+  ///   commands are executed in order and zero means the number of hardware
+  ///   threads.  The commands must be independent of each other and access
+  ///   the shared context in a thread safe way if this is not one.  If a
+  ///   command throws an exception no later command is started.
+  ///
+  template<typename Factory, typename = std::enable_if_t<std::is_invocable_v<Factory>>>
+  void batch(Factory factory, args_t::iterator first, args_t::iterator last, std::string_view separator = ";",
+    unsigned concurrency = 1)
+  {
+    std::vector<range_t> commands;
+    while(first != last)
+    {
+      auto end = std::find(first, last, separator);
+      if(first != end)
+        commands.emplace_back(first, end);
+      first = end == last ? last : end + 1;
+    }
+    execute(factory, commands, concurrency);
+  }
+
+  ///
+  /// @brief Parse and execute a batch of commands separated by a separator
+  ///   word using an existing context.
+  ///
+  /// @param context
+  ///   The context is passed as the first argument of the callback functions.
+  /// @param first, last
+  ///   The range of arguments to parse.
+  /// @param separator
+  ///   The word separating the commands.
+  /// @param concurrency
+  ///   The maximum number of commands executed concurrently.
+  ///
+  void batch(Context& context, args_t::iterator first, args_t::iterator last, std::string_view separator = ";",
+    unsigned concurrency = 1)
+  {
+    batch([&context]() -> Context& { return context; }, first, last, separator, concurrency);
+  }
+
+  ///
+  /// @brief Parse and execute a batch of commands read from a stream.
+  ///
+  /// @details
+  ///   Each line is one command with words separated by whitespace.  Empty
+  ///   lines and lines starting with `#` are ignored.  The whole stream is
+  ///   read and all commands are checked before any of them are executed.
+  ///
+  /// @tparam Factory
+  ///   A function taking no arguments and returning a `Context` or a
+  ///   reference to one.
+  /// @param factory
+  ///   Creates the context.
+  /// @param is
+  ///   The stream to read the commands from.
+  /// @param concurrency
+  ///   The maximum number of commands executed concurrently.
+  ///
+  template<typename Factory, typename = std::enable_if_t<std::is_invocable_v<Factory>>>
+  void batch(Factory factory, std::istream& is, unsigned concurrency = 1)
+  {
+    std::vector<args_t> lines;
+    std::string line;
+    while(std::getline(is, line))
+    {
+      std::istringstream words(line);
+      args_t args{std::istream_iterator<std::string>(words), std::istream_iterator<std::string>()};
+      if(!args.empty() && args.front().front() != '#')
+        lines.push_back(std::move(args));
+    }
+    std::vector<range_t> commands;
+    commands.reserve(lines.size());
+    for(auto& args: lines)
+      commands.emplace_back(args.begin(), args.end());
+    execute(factory, commands, concurrency);
+  }
+
+  ///
+  /// @brief Parse and execute a batch of commands read from a stream using an
+  ///   existing context.
+  ///
+  /// @param context
+  ///   The context is passed as the first argument of the callback functions.
+  /// @param is
+  ///   The stream to read the commands from.
+  /// @param concurrency
+  ///   The maximum number of commands executed concurrently.
+  ///
+  void batch(Context& context, std::istream& is, unsigned concurrency = 1)
+  {
+    batch([&context]() -> Context& { return context; }, is, concurrency);
   }
 
 private:
+  /// @brief The callback of a command.
+  using callback_t = std::variant<function_t, simple_t>;
+  /// @brief The range of words of one command in a batch.
+  using range_t = std::pair<args_t::iterator, args_t::iterator>;
+
+  ///
+  /// @brief Returns the callback of a command, or throws a `usage_error` if
+  ///   there is no such command.
+  ///
+  /// @param command
+  ///   Points to the name of the command.
+  ///
+  const callback_t& lookup(args_t::iterator command)
+  {
+    auto c = _commands.find(*command);
+    if(c == _commands.end())
+      usage(*command);
+    return c->second;
+  }
+
+  ///
+  /// @brief Checks and executes a batch of commands.
+  ///
+  /// @param factory
+  ///   Creates the context if any of the commands needs it.
+  /// @param commands
+  ///   The commands, each a non-empty range of words.
+  /// @param concurrency
+  ///   The maximum number of commands executed concurrently.
+  ///
+  template<typename Factory>
+  void execute(Factory& factory, const std::vector<range_t>& commands, unsigned concurrency)
+  {
+    std::vector<const callback_t*> callbacks;
+    callbacks.reserve(commands.size());
+    bool needs_context = false;
+    for(auto [first, last]: commands)
+    {
+      callbacks.push_back(&lookup(first));
+      needs_context = needs_context || std::holds_alternative<function_t>(*callbacks.back());
+      if(auto v = _validators.find(*first); v != _validators.end())
+        if(auto reason = v->second(first + 1, last))
+          option::usage(Error({*first + ": " + *reason}), command_list());
+    }
+    auto run = [&](Context* context) {
+      parallel_for(commands.size(), concurrency, [&](std::size_t i) {
+        auto [first, last] = commands[i];
+        // clang-format off
+        std::visit(
+          overloaded{
+            [&](const function_t& f) { f(*context, first + 1, last); },
+            [&](const simple_t& f) { f(first + 1, last); }},
+          *callbacks[i]);
+        // clang-format on
+      });
+    };
+    if(needs_context)
+    {
+      decltype(auto) context = factory();
+      run(&context);
+    }
+    else
+      run(nullptr);
+  }
+
+  ///
+  /// @brief Registers a command.
+  ///
+  /// @param name
+  ///   The name of the command.
+  /// @param callback
+  ///   The callback function.
+  ///
+  Commands& add(const std::string& name, callback_t callback)
+  {
+    auto key = _names->intern(name);
+    _command_list.push_back(key);
+    _commands.emplace(key, std::move(callback));
+    return *this;
+  }
+
   ///
   /// @brief Called when the argument parsing fails.
   ///
-  void usage()
+  /// @param command
+  ///   The unknown command, if any.  If exactly one command is nearest to
+  ///   it the usage error includes a suggestion.
+  ///
+  void usage(std::string_view command = {})
+  {
+    if(!command.empty())
+    {
+      Nearest nearest(command);
+      for(auto& [name, f]: _commands)
+        nearest(name);
+      if(!nearest.best().empty())
+        option::usage(
+          Error({"unknown command: " + std::string(command) + did_you_mean(nearest.best())}), command_list());
+    }
+    option::usage(command_list());
+  }
+
+  ///
+  /// @brief Returns the lines of the usage message.
+  ///
+  std::vector<std::string> command_list()
   {
-    option::usage(_command_list);
+    std::vector<std::string> command_list;
+    for(auto name: _command_list)
+      command_list.push_back(_program_name ? cat(*_program_name, std::string(name)) : std::string(name));
+    return command_list;
   }
-  
-  /// @brief List of commands in alphabetic order.  Used for the usage message.
-  std::vector<std::string> _command_list;
+
+  /// @brief The pool holding the command names.  Declared first so that it
+  ///   outlives all the views of the names.
+  std::shared_ptr<StringPool> _names;
+  /// @brief List of commands in the order they were added.  Used for the
+  ///   usage message.  The names are interned in `_names`.
+  std::vector<std::string_view> _command_list;
   /// @brief Map of commands to callback functions.
-  std::map<std::string, function_t> _commands;
+  std::map<std::string_view, callback_t, std::less<>> _commands;
+  /// @brief Map of commands to completion functions.
+  std::map<std::string_view, completer_t, std::less<>> _completers;
+  /// @brief Map of commands to argument validation functions.
+  std::map<std::string_view, validator_t, std::less<>> _validators;
   /// @brief Name of the program.
   std::optional<std::string> _program_name;
 
@@ -14,6 +14,12 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 #include "Commands.hh"
 
@@ -94,3 +100,210 @@ TEST_CASE("Lookup command should fail with no program name")
     "       test3");
 
 }
+
+TEST_CASE("Complete commands")
+{
+  Commands<int> commands("test");
+  commands.command("test0", test0);
+  commands.command("test1", test1);
+  commands.command("other", test2);
+  commands.completer("test0", [](args_t::iterator first, args_t::iterator last) {
+    return std::vector<std::string>{std::string(*first) + std::to_string(std::distance(first, last))};
+  });
+  SECTION("Command names")
+  {
+    std::vector<std::string> args = {"te"};
+    CHECK(commands.complete(args.begin(), args.end()) == std::vector<std::string>{"test0", "test1"});
+  }
+  SECTION("Command arguments")
+  {
+    std::vector<std::string> args = {"test0", "--a", ""};
+    CHECK(commands.complete(args.begin(), args.end()) == std::vector<std::string>{"--a2"});
+  }
+  SECTION("No completer")
+  {
+    std::vector<std::string> args = {"test1", ""};
+    CHECK(commands.complete(args.begin(), args.end()).empty());
+  }
+}
+
+TEST_CASE("Suggest the nearest command")
+{
+  Commands<int> commands("test");
+  commands.command("build", test0);
+  commands.command("clean", test1);
+  std::vector<std::string> args = {"biuld"};
+  int context;
+  REQUIRE_THROWS_WITH(commands.parse(context, args.begin(), args.end()),
+    "unknown command: biuld (did you mean build?)\n"
+    "usage: test build\n"
+    "       test clean");
+}
+
+TEST_CASE("Create the context only when needed")
+{
+  Commands<int> commands("test");
+  int created = 0;
+  bool help = false;
+  commands.command("build", test1);
+  commands.command("help", [&help](args_t::iterator, args_t::iterator) { help = true; });
+  commands.command(
+    "version", []() { return std::string("1.0"); },
+    [&help](std::string& version, args_t::iterator, args_t::iterator) { help = version == "1.0"; });
+  auto factory = [&created]() {
+    ++created;
+    return 0;
+  };
+  SECTION("Command without context")
+  {
+    std::vector<std::string> args = {"help"};
+    commands.parse(factory, args.begin(), args.end());
+    CHECK(help);
+    CHECK(created == 0);
+  }
+  SECTION("Command with its own context")
+  {
+    std::vector<std::string> args = {"version"};
+    commands.parse(factory, args.begin(), args.end());
+    CHECK(help);
+    CHECK(created == 0);
+  }
+  SECTION("Command with context")
+  {
+    std::vector<std::string> args = {"build"};
+    commands.parse(factory, args.begin(), args.end());
+    CHECK(created == 1);
+  }
+  SECTION("Unknown command")
+  {
+    std::vector<std::string> args = {"unknown"};
+    REQUIRE_THROWS(commands.parse(factory, args.begin(), args.end()));
+    CHECK(created == 0);
+  }
+  SECTION("Existing context")
+  {
+    std::vector<std::string> args = {"help"};
+    int context = 5;
+    commands.parse(context, args.begin(), args.end());
+    CHECK(help);
+    CHECK(context == 5);
+  }
+}
+
+TEST_CASE("Execute a batch of commands")
+{
+  Commands<std::vector<std::string>> commands("test");
+  int created = 0;
+  auto factory = [&created]() {
+    ++created;
+    return std::vector<std::string>();
+  };
+  std::vector<std::string> log;
+  commands.command("create", [](std::vector<std::string>& context, args_t::iterator first, args_t::iterator last) {
+    context.push_back("create " + std::to_string(std::distance(first, last)));
+  });
+  commands.command("start", [&log](args_t::iterator first, args_t::iterator) { log.push_back("start " + *first); });
+  commands.validator("start", [](args_t::iterator first, args_t::iterator last) -> std::optional<std::string> {
+    if(std::distance(first, last) != 1)
+      return "expected one argument";
+    return {};
+  });
+  SECTION("Separator")
+  {
+    std::vector<std::string> context;
+    std::vector<std::string> args = {"create", "a", "b", ";", ";", "start", "a", ";", "create"};
+    commands.batch(context, args.begin(), args.end());
+    CHECK(context == std::vector<std::string>{"create 2", "create 0"});
+    CHECK(log == std::vector<std::string>{"start a"});
+  }
+  SECTION("Fail before executing any command")
+  {
+    std::vector<std::string> args = {"create", ";", "start", ";", "stop"};
+    REQUIRE_THROWS_WITH(commands.batch(factory, args.begin(), args.end()), "start: expected one argument\n"
+                                                                           "usage: test create\n"
+                                                                           "       test start");
+    args = {"create", ";", "start", "a", ";", "strat"};
+    REQUIRE_THROWS_WITH(commands.batch(factory, args.begin(), args.end()),
+      Catch::Matchers::ContainsSubstring("unknown command: strat"));
+    CHECK(created == 0);
+  }
+  SECTION("Context created only when needed")
+  {
+    std::vector<std::string> args = {"start", "a", "+", "start", "b"};
+    commands.batch(factory, args.begin(), args.end(), "+");
+    CHECK(created == 0);
+    CHECK(log == std::vector<std::string>{"start a", "start b"});
+  }
+  SECTION("Read from a stream")
+  {
+    std::istringstream is("# comment\ncreate x\n\n  start  y\n");
+    std::vector<std::string> context;
+    commands.batch(context, is);
+    CHECK(context == std::vector<std::string>{"create 1"});
+    CHECK(log == std::vector<std::string>{"start y"});
+  }
+  SECTION("Concurrently")
+  {
+    Commands<std::atomic<int>> counter;
+    counter.command("add", [](std::atomic<int>& context, args_t::iterator first, args_t::iterator) {
+      context += std::stoi(*first);
+    });
+    std::vector<std::string> args;
+    for(int i = 1; i <= 100; ++i)
+      args.insert(args.end(), {"add", std::to_string(i), ";"});
+    std::atomic<int> sum{0};
+    counter.batch(sum, args.begin(), args.end(), ";", 4);
+    CHECK(sum == 5050);
+  }
+}
+
+TEST_CASE("Commands from plugins")
+{
+  auto manifest = std::filesystem::temp_directory_path() / "option-plugins.conf";
+  {
+    std::ofstream os(manifest);
+    os << "# Plugins\n"
+       << "attach = libattach.so\n"
+       << "start-all = /opt/lib/libcontrol.so control_start\n";
+#ifdef OPTION_TEST_PLUGIN
+    os << "test = " << OPTION_TEST_PLUGIN << " test_plugin\n";
+#endif
+  }
+  SECTION("Manifest")
+  {
+    auto entries = Plugin::manifest(manifest);
+    REQUIRE(entries.size() >= 2);
+    CHECK(entries[0].name == "attach");
+    CHECK(entries[0].library == manifest.parent_path() / "libattach.so");
+    CHECK(entries[0].symbol == "attach");
+    CHECK(entries[1].name == "start-all");
+    CHECK(entries[1].library == "/opt/lib/libcontrol.so");
+    CHECK(entries[1].symbol == "control_start");
+  }
+  SECTION("Library is loaded on dispatch")
+  {
+    Commands<int> commands("test");
+    commands.command("help", test0);
+    commands.plugins(manifest);
+    int context = -1;
+    std::vector<std::string> args = {"help"};
+    commands.parse(context, args.begin(), args.end());
+    CHECK(context == 0);
+    args = {"attach"};
+    REQUIRE_THROWS_AS(commands.parse(context, args.begin(), args.end()), std::runtime_error);
+    args = {"stop"};
+    REQUIRE_THROWS_WITH(
+      commands.parse(context, args.begin(), args.end()), Catch::Matchers::ContainsSubstring("test start-all"));
+#ifdef OPTION_TEST_PLUGIN
+    args = {"test", "a", "b"};
+    commands.parse(context, args.begin(), args.end());
+    CHECK(context == 102);
+#endif
+  }
+  SECTION("Malformed manifest")
+  {
+    std::ofstream(manifest) << "attach = libattach.so attach extra\n";
+    REQUIRE_THROWS_WITH(Plugin::manifest(manifest), Catch::Matchers::ContainsSubstring("expected library [symbol]"));
+  }
+  std::filesystem::remove(manifest);
+}
@@ -0,0 +1,163 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "MappedFile.hh"
+
+namespace kuri::option
+{
+///
+/// @brief A configuration file with option values.
+///
+/// @details
+///   Each line of the file is either empty, a comment starting with `#`, or
+///   a `key = value` pair.  Whitespace around keys and values is ignored.
+///   The key is the name of an option without the leading double hyphen.
+///
+/// @code
+///   # Defaults for all projects.
+///   threads = 8
+///   verbose = 1
+/// @endcode
+///
+///   The file is memory mapped and the keys and values are views of the
+///   mapped file, so parsing allocates nothing but the table of entries.
+///
+class ConfigFile
+{
+public:
+  ///
+  /// @brief A `key = value` line of the file.
+  ///
+  struct entry_t
+  {
+    /// @brief The key.
+    std::string_view key;
+    /// @brief The value.
+    std::string_view value;
+    /// @brief The whole line, used in error messages.
+    std::string_view line;
+  };
+
+  ///
+  /// @brief Maps and parses a configuration file.
+  ///
+  /// @param path The path of the file.
+  /// @throws std::system_error if the file can't be mapped.
+  /// @throws std::runtime_error if a line is not a comment or a `key = value`
+  ///   pair.
+  ///
+  explicit ConfigFile(const std::filesystem::path& path): _file(path)
+  {
+    auto data = _file.data();
+    _entries.reserve(static_cast<std::size_t>(std::count(data.begin(), data.end(), '=')));
+    std::size_t number = 0;
+    while(!data.empty())
+    {
+      ++number;
+      auto end = data.find('\n');
+      auto line = trim(data.substr(0, end));
+      data = end == std::string_view::npos ? std::string_view() : data.substr(end + 1);
+      if(line.empty() || line.front() == '#')
+        continue;
+      auto pos = line.find('=');
+      auto key = trim(line.substr(0, pos));
+      if(pos == std::string_view::npos || key.empty())
+        throw std::runtime_error(
+          "ConfigFile: " + path.string() + ":" + std::to_string(number) + ": expected key = value");
+      _entries.push_back({key, trim(line.substr(pos + 1)), line});
+    }
+  }
+
+  ///
+  /// @brief Returns the parsed form of a configuration file, parsing it only
+  ///   if it isn't already cached.
+  ///
+  /// @details
+  ///   The cache is kept for the lifetime of the process and is keyed by the
+  ///   path, modification time, and size of the file.  A file which has
+  ///   changed since it was cached is parsed again.
+  ///
+  /// @param path The path of the file.
+  /// @return The parsed file, or null if the file doesn't exist.
+  /// @throws std::system_error or std::runtime_error if the file exists but
+  ///   can't be read or parsed.
+  ///
+  static std::shared_ptr<const ConfigFile> load(const std::filesystem::path& path)
+  {
+    struct stat st;
+    if(::stat(path.c_str(), &st) < 0)
+    {
+      if(errno == ENOENT)
+        return {};
+      throw std::system_error(errno, std::generic_category(), "ConfigFile: " + path.string());
+    }
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const ConfigFile>> cache;
+    std::lock_guard lock(mutex);
+    auto& cached = cache[path.string()];
+    if(!cached || !cached->same(st))
+      cached = std::make_shared<const ConfigFile>(path);
+    return cached;
+  }
+
+  ///
+  /// @brief Returns the entries in the order they appear in the file.
+  ///
+  const std::vector<entry_t>& entries() const noexcept { return _entries; }
+
+private:
+  /// @brief The mapped file.
+  MappedFile _file;
+  /// @brief The `key = value` lines of the file.
+  std::vector<entry_t> _entries;
+
+  ///
+  /// @brief Returns true if the file status matches the mapped file.
+  ///
+  bool same(const struct stat& st) const noexcept
+  {
+    return st.st_mtim.tv_sec == _file.mtime().tv_sec && st.st_mtim.tv_nsec == _file.mtime().tv_nsec
+      && static_cast<std::size_t>(st.st_size) == _file.data().size();
+  }
+
+  ///
+  /// @brief Removes leading and trailing whitespace.
+  ///
+  static std::string_view trim(std::string_view s) noexcept
+  {
+    auto first = s.find_first_not_of(" \t\r");
+    if(first == std::string_view::npos)
+      return {};
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+  }
+};
+
+} // namespace kuri::option
@@ -0,0 +1,208 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "compiled.hh"
+
+#if KURI_OPTION_DEFINITIONS
+#include <ostream>
+#include <thread>
+
+#include <fmt/format.h>
+#endif
+
+namespace kuri::option
+{
+///
+/// @brief True if the instrumentation hooks are compiled in.
+///
+/// @details
+///   The hooks are compiled in when the macro `KURI_OPTION_INSTRUMENTATION`
+///   is defined, for example by configuring with `-DOPTION_INSTRUMENTATION=ON`.
+///   All translation units of a program must agree on the macro.
+///
+#ifdef KURI_OPTION_INSTRUMENTATION
+inline constexpr bool instrumented = true;
+#else
+inline constexpr bool instrumented = false;
+#endif
+
+///
+/// @brief Receives measurements from `Program`.
+///
+/// @details
+///   Derive from this class and pass the object to `Program::instrument`.
+///   The functions are called from the threads executing the callbacks so
+///   an implementation must be thread safe if callbacks run concurrently.
+///
+class Instrumentation
+{
+public:
+  /// @brief The clock used for all time points.
+  using clock = std::chrono::steady_clock;
+
+  ///
+  /// @brief Counters for one call to `Program::parse` or `Program::stream`.
+  ///
+  /// @details
+  ///   Memory allocations are not counted.  Most of them happen in the
+  ///   standard library and in the callbacks, neither of which the library
+  ///   can observe.  Use a replacement `operator new` to count them.
+  ///
+  struct counters_t
+  {
+    /// @brief Command line arguments looked at, summed over all groups tried.
+    std::size_t tokens = 0;
+    /// @brief Groups tried.
+    std::size_t groups = 0;
+    /// @brief Option name lookups.
+    std::size_t lookups = 0;
+    /// @brief Groups which failed.
+    std::size_t errors = 0;
+  };
+
+  ///
+  /// @brief Virtual destructor.
+  ///
+  virtual ~Instrumentation() = default;
+
+  ///
+  /// @brief Called at the end of each parse, whether it succeeded or not.
+  ///
+  /// @param counters The counters of the parse.
+  /// @param start, end The time spent parsing, including the callbacks.
+  ///
+  virtual void parse(const counters_t& counters, clock::time_point start, clock::time_point end) = 0;
+
+  ///
+  /// @brief Called after the callback of an option has been executed.
+  ///
+  /// @param option The name of the option.
+  /// @param start, end The time spent in the callback.
+  ///
+  virtual void callback(std::string_view option, clock::time_point start, clock::time_point end) = 0;
+};
+
+///
+/// @brief Records measurements as events in the Chrome trace event format.
+///
+/// @details
+///   The output of `write` can be loaded in `chrome://tracing` or Perfetto.
+///   Each parse and each callback is a complete event on the thread which
+///   executed it.  The counters are attached as arguments of the parse
+///   event.
+///
+class ChromeTrace: public Instrumentation
+{
+public:
+  void parse(const counters_t& counters, clock::time_point start, clock::time_point end) override;
+  void callback(std::string_view option, clock::time_point start, clock::time_point end) override;
+
+  ///
+  /// @brief Writes the recorded events as a JSON array.
+  ///
+  /// @param os The output stream.
+  ///
+  void write(std::ostream& os) const;
+
+  ///
+  /// @brief Returns the number of recorded events.
+  ///
+  std::size_t size() const
+  {
+    std::lock_guard lock(_mutex);
+    return _events.size();
+  }
+
+private:
+  /// @brief Protects the events.
+  mutable std::mutex _mutex;
+  /// @brief The events formatted as JSON objects.
+  std::vector<std::string> _events;
+  /// @brief Time stamps are relative to the creation of the object.
+  clock::time_point _epoch = clock::now();
+
+  ///
+  /// @brief Record a complete event.
+  ///
+  void add(std::string_view name, clock::time_point start, clock::time_point end, std::string_view args);
+
+  ///
+  /// @brief Escape a string for use in a JSON string.
+  ///
+  static std::string escape(std::string_view s);
+};
+
+#if KURI_OPTION_DEFINITIONS
+
+KURI_OPTION_INLINE void ChromeTrace::parse(const counters_t& counters, clock::time_point start, clock::time_point end)
+{
+  add("parse", start, end,
+    fmt::format(R"("tokens":{},"groups":{},"lookups":{},"errors":{})", counters.tokens, counters.groups,
+      counters.lookups, counters.errors));
+}
+
+KURI_OPTION_INLINE void ChromeTrace::callback(std::string_view option, clock::time_point start, clock::time_point end)
+{
+  add(option, start, end, {});
+}
+
+KURI_OPTION_INLINE void ChromeTrace::write(std::ostream& os) const
+{
+  std::lock_guard lock(_mutex);
+  os << "[";
+  for(std::size_t i = 0; i < _events.size(); ++i)
+    os << (i == 0 ? "\n" : ",\n") << _events[i];
+  os << "\n]\n";
+}
+
+KURI_OPTION_INLINE void ChromeTrace::add(
+  std::string_view name, clock::time_point start, clock::time_point end, std::string_view args)
+{
+  using us = std::chrono::duration<double, std::micro>;
+  auto event = fmt::format(R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{{}}}}})",
+    escape(name), std::hash<std::thread::id>()(std::this_thread::get_id()) % 1000000,
+    us(start - _epoch).count(), us(end - start).count(), args);
+  std::lock_guard lock(_mutex);
+  _events.push_back(std::move(event));
+}
+
+KURI_OPTION_INLINE std::string ChromeTrace::escape(std::string_view s)
+{
+  std::string result;
+  for(auto c: s)
+  {
+    if(c == '"' || c == '\\')
+      result += '\\';
+    if(static_cast<unsigned char>(c) < 0x20)
+      result += fmt::format("\\u{:04x}", static_cast<int>(c));
+    else
+      result += c;
+  }
+  return result;
+}
+
+#endif
+
+} // namespace kuri::option
@@ -0,0 +1,94 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This test is compiled with KURI_OPTION_INSTRUMENTATION defined.
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_session.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+#include <sstream>
+
+#include "Instrumentation.hh"
+#include "Program.hh"
+
+using namespace kuri::option;
+
+namespace
+{
+class Recorder: public Instrumentation
+{
+public:
+  void parse(const counters_t& c, clock::time_point, clock::time_point) override { counters.push_back(c); }
+  void callback(std::string_view option, clock::time_point start, clock::time_point end) override
+  {
+    callbacks.emplace_back(option);
+    CHECK(start <= end);
+  }
+  std::vector<counters_t> counters;
+  std::vector<std::string> callbacks;
+};
+} // namespace
+
+TEST_CASE("Instrumentation counters and callbacks")
+{
+  static_assert(instrumented);
+  Recorder recorder;
+  Program program("test");
+  program.instrument(&recorder)
+    .optional("--a", []() {})
+    .optional("--b", [](const Option&) {})
+    .args(1, 1)
+    .optional("--c", []() {});
+  std::vector<std::string> args = {"--a", "--b", "x", "file"};
+  program.parse(args.begin(), args.end());
+  REQUIRE(recorder.counters.size() == 1);
+  CHECK(recorder.counters[0].groups == 1);
+  CHECK(recorder.counters[0].tokens == 4);
+  CHECK(recorder.counters[0].lookups == 3);
+  CHECK(recorder.counters[0].errors == 0);
+  CHECK(recorder.callbacks == std::vector<std::string>{"--a", "--b"});
+  args = {"--c"};
+  program.parse(args.begin(), args.end());
+  REQUIRE(recorder.counters.size() == 2);
+  CHECK(recorder.counters[1].groups == 2);
+  CHECK(recorder.counters[1].errors == 1);
+  args = {"--d"};
+  CHECK_THROWS(program.parse(args.begin(), args.end()));
+  REQUIRE(recorder.counters.size() == 3);
+  CHECK(recorder.counters[2].errors == recorder.counters[2].groups);
+}
+
+TEST_CASE("Chrome trace")
+{
+  ChromeTrace trace;
+  Program program("test");
+  program.instrument(&trace).optional("--\"quoted\"", []() {}).args();
+  std::vector<std::string> args = {"--\"quoted\""};
+  program.parse(args.begin(), args.end());
+  CHECK(trace.size() == 2);
+  std::ostringstream os;
+  trace.write(os);
+  CHECK_THAT(os.str(), Catch::Matchers::ContainsSubstring(R"("name":"--\"quoted\"","ph":"X")"));
+  CHECK_THAT(os.str(), Catch::Matchers::ContainsSubstring(R"("args":{"tokens":1,"groups":1,"lookups":1,"errors":0})"));
+}
+
+int main(int argc, char* argv[])
+{
+  int result = Catch::Session().run(argc, argv);
+  return result;
+}
@@ -0,0 +1,125 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kuri::option
+{
+///
+/// @brief A read-only memory mapping of a file.
+///
+class MappedFile
+{
+public:
+  ///
+  /// @brief Maps the contents of a file into memory.
+  ///
+  /// @param path The path of the file.
+  /// @throws std::system_error if the file can't be opened or mapped.
+  ///
+  explicit MappedFile(const std::filesystem::path& path)
+  {
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+      throw std::system_error(errno, std::generic_category(), "MappedFile: " + path.string());
+    struct stat st;
+    if(::fstat(fd, &st) < 0)
+    {
+      auto error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "MappedFile: " + path.string());
+    }
+    _size = static_cast<std::size_t>(st.st_size);
+    _mtime = st.st_mtim;
+    if(_size > 0)
+    {
+      auto* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(data == MAP_FAILED)
+      {
+        auto error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "MappedFile: " + path.string());
+      }
+      _data = data;
+    }
+    ::close(fd);
+  }
+  ///
+  /// @brief Unmaps the file.
+  ///
+  ~MappedFile()
+  {
+    if(_data != nullptr)
+      ::munmap(_data, _size);
+  }
+  ///
+  /// @brief No copying allowed.
+  ///
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ///
+  /// @brief Move constructor.  The mapping keeps its address.
+  ///
+  /// @param file The mapped file to move.
+  ///
+  MappedFile(MappedFile&& file) noexcept { *this = std::move(file); }
+  ///
+  /// @brief Move assignment operator.
+  ///
+  /// @param file The mapped file to move assign.
+  ///
+  MappedFile& operator=(MappedFile&& file) noexcept
+  {
+    if(&file != this)
+    {
+      if(_data != nullptr)
+        ::munmap(_data, _size);
+      _data = std::exchange(file._data, nullptr);
+      _size = std::exchange(file._size, 0);
+      _mtime = file._mtime;
+    }
+    return *this;
+  }
+
+  ///
+  /// @brief Returns the contents of the file.
+  ///
+  std::string_view data() const noexcept { return {static_cast<const char*>(_data), _size}; }
+  ///
+  /// @brief Returns the modification time of the file when it was mapped.
+  ///
+  const struct timespec& mtime() const noexcept { return _mtime; }
+
+private:
+  /// @brief The start of the mapping or null for an empty file.
+  void* _data = nullptr;
+  /// @brief The size of the file.
+  std::size_t _size = 0;
+  /// @brief The modification time of the file.
+  struct timespec _mtime = {};
+};
+
+} // namespace kuri::option
@@ -1,4 +1,4 @@
-// Copyright 2021 Krister Joas
+// Copyright 2021, 2026 Krister Joas
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -14,37 +14,94 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <variant>
-
-#include <fmt/format.h>
+#include <vector>
 
 #include "overloaded.hh"
+#include "parse_args.hh"
 
 using namespace std::literals;
 
 namespace kuri::option
 {
+///
+/// @brief The reason a group of options rejected the command line.
+///
+enum class error_code
+{
+  /// @brief No error, the group was selected.
+  none,
+  /// @brief An argument starting with a hyphen is not an option of the group.
+  unknown_option,
+  /// @brief An abbreviated option matches more than one option.
+  ambiguous_option,
+  /// @brief An option without a value was given a value.
+  illegal_value,
+  /// @brief The value of an option was rejected by its check.
+  invalid_value,
+  /// @brief The last option on the command line takes a value.
+  missing_value,
+  /// @brief A required option is missing.
+  missing_required,
+  /// @brief A constraint between options is violated.
+  constraint,
+  /// @brief Wrong number of arguments after the options.
+  argument_count,
+  /// @brief The arguments exceed one of the limits set by `Program::limits`.
+  limit_exceeded,
+  /// @brief Any other error.
+  other
+};
+
 ///
 /// @brief Exception used internally to signal any argument parsing error.
 ///
 class argument_error: public std::exception
 {
 public:
+  /// @brief The token index of an error not caused by a particular argument.
+  static constexpr std::size_t no_token = static_cast<std::size_t>(-1);
+
   ///
   /// @brief Exception constructor.
   ///
   /// @param message The exception message.
   argument_error(const std::string& message): _message(message) {}
+  ///
+  /// @brief Exception constructor with the reason for the error.
+  ///
+  /// @param code The reason for the error.
+  /// @param message The exception message.
+  /// @param token The index of the argument causing the error, counted from
+  ///   the start of the parsed range.
+  argument_error(error_code code, const std::string& message, std::size_t token = no_token)
+    : _code(code), _token(token), _message(message)
+  {}
 
   ///
   /// @brief Exception message.
   ///
   virtual const char* what() const noexcept { return _message.c_str(); }
+  ///
+  /// @brief The reason for the error.
+  ///
+  error_code code() const noexcept { return _code; }
+  ///
+  /// @brief The index of the argument causing the error, or `no_token`.
+  ///
+  std::size_t token() const noexcept { return _token; }
 
 private:
+  /// @brief The reason for the error.
+  error_code _code = error_code::other;
+  /// @brief The index of the argument causing the error.
+  std::size_t _token = no_token;
   /// @brief The message string.
   std::string _message;
 };
@@ -59,22 +116,28 @@ public:
   ///
   /// @brief Constructor for a boolean option.
   ///
-  /// @param name The name of the option with the hyphen prefixes.
+  /// @param name The name of the option with the hyphen prefixes.  It must
+  ///   outlive the option.  `Program` passes a name interned in its
+  ///   `StringPool`.
   /// @param required True if the option is required, false if it's optional.
   /// @param f The callback function.  This is a function returning void taking
   ///   no arguments.
   ///
-  Option(const std::string& name, bool required, std::function<void()> f): _name(name), required(required), _fun(f) {}
+  Option(std::string_view name, bool required, std::function<void()> f)
+    : required(required), _name(name), _fun(f)
+  {}
   ///
   /// @brief Constructor for an option taking a value.
   ///
-  /// @param name The name of the option with the hyphen prefixes.
+  /// @param name The name of the option with the hyphen prefixes.  It must
+  ///   outlive the option.  `Program` passes a name interned in its
+  ///   `StringPool`.
   /// @param required True if the option is required, false if it's optional.
   /// @param f The callback function.  This callback function returns void and
   ///   takes a `const Option&` as its parameter.
   ///
-  Option(const std::string& name, bool required, std::function<void(const Option&)> f)
-    : _name(name), required(required), _fun(f)
+  Option(std::string_view name, bool required, std::function<void(const Option&)> f)
+    : required(required), _name(name), _fun(f)
   {}
   ///
   /// @brief Default constructor is deleted.
@@ -106,7 +169,11 @@ public:
       required = option.required;
       set = option.set;
       value = std::move(option.value);
-      _name = std::move(option._name);
+      id = option.id;
+      dependencies = std::move(option.dependencies);
+      check = std::move(option.check);
+      constraint_bit = option.constraint_bit;
+      _name = option._name;
       _fun = std::move(option._fun);
     }
     return *this;
@@ -118,12 +185,23 @@ public:
   bool required = false;
   /// @brief Used while parsing to check if the value has been set.
   bool set = false;
+  /// @brief The id of the option name assigned by `Program`.
+  option_id id = 0;
+  /// @brief Ids of options whose callbacks must be executed before the
+  ///   callback of this option.
+  std::vector<option_id> dependencies;
+  /// @brief Optional predicate checking the value of an option taking a
+  ///   value.  A value for which the predicate returns false is an error.
+  std::function<bool(std::string_view)> check;
+  /// @brief The bit representing the option in the constraints of its group,
+  ///   or zero if the option isn't part of any constraint.
+  std::uint64_t constraint_bit = 0;
   ///
   /// @brief Return the name of the option.
   ///
   /// @return Then the name of the option.
   ///
-  std::string name() const noexcept { return _name; }
+  std::string name() const { return std::string(_name); }
   ///
   /// @brief Returns true if this option takes a value.
   ///
@@ -154,16 +232,35 @@ public:
   ///
   std::string help() const
   {
-    if(required)
-      return fmt::format("{}{}", _name, argument() ? " <value>"s : ""s);
-    return fmt::format("[{}{}]", _name, argument() ? " <value>"s : ""s);
+    std::string help(_name);
+    if(argument())
+      help += " <value>";
+    return required ? help : "[" + help + "]";
   }
 
 private:
-  /// @brief The name of the option.
-  std::string _name;
+  /// @brief The name of the option, interned in the program's `StringPool`.
+  std::string_view _name;
   /// @brief The callback function.
   std::variant<std::function<void()>, std::function<void(const Option&)>> _fun;
 };
 
+///
+/// @brief Describes an option in a static table of options.
+///
+/// @details
+///   Used with `Program::options` to add many options at once, typically from
+///   a generated `constexpr` table.  Options added this way have no callback
+///   and the result of parsing is read from a `ParseResult`.
+///
+struct OptionSpec
+{
+  /// @brief The name of the option with the hyphen prefixes.
+  std::string_view name;
+  /// @brief True if the option is required.
+  bool required = false;
+  /// @brief True if the option takes a value.
+  bool argument = false;
+};
+
 } // namespace kuri::option
@@ -0,0 +1,225 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "cache_stats.hh"
+#include "parse_args.hh"
+#include "string_functions.hh"
+
+namespace kuri::option
+{
+///
+/// @brief A least recently used cache keyed by a sequence of command line
+///   arguments.
+///
+/// @details
+///   The key is a hash of the arguments.  A copy of the arguments is kept
+///   with each entry and compared on lookup so a hash collision is a miss,
+///   never a wrong result.  When the cache is full the least recently used
+///   entry is evicted.  A capacity of zero disables the cache.
+///
+///   Command lines whose arguments add up to more than a byte budget are
+///   not cached, which bounds the memory used by the copies of the
+///   arguments to the capacity times the budget.
+///
+/// @tparam T The type of the cached values.
+///
+template<typename T>
+class ParseCache
+{
+public:
+  /// @brief The default byte budget of one command line.
+  static constexpr std::size_t default_line_bytes = 4096;
+
+  ///
+  /// @brief Creates a cache.
+  ///
+  /// @param capacity The maximum number of entries.
+  /// @param line_bytes The maximum total length of the arguments of an
+  ///   entry.
+  ///
+  explicit ParseCache(std::size_t capacity = 0, std::size_t line_bytes = default_line_bytes)
+    : _capacity(capacity),
+      _line_bytes(line_bytes)
+  {}
+
+  ///
+  /// @brief Returns the maximum number of entries.
+  ///
+  std::size_t capacity() const noexcept { return _capacity; }
+  ///
+  /// @brief Returns the maximum total length of the arguments of an entry.
+  ///
+  std::size_t line_bytes() const noexcept { return _line_bytes; }
+  ///
+  /// @brief Returns the number of entries.
+  ///
+  std::size_t size() const noexcept { return _entries.size(); }
+  ///
+  /// @brief Returns the counters.
+  ///
+  const cache_stats_t& stats() const noexcept { return _stats; }
+
+  ///
+  /// @brief Changes the maximum number of entries, evicting the least
+  ///   recently used entries if there are too many.
+  ///
+  /// @param capacity The maximum number of entries.
+  ///
+  void capacity(std::size_t capacity)
+  {
+    _capacity = capacity;
+    while(_entries.size() > _capacity)
+      evict();
+  }
+
+  ///
+  /// @brief Changes the maximum total length of the arguments of an entry.
+  ///   Entries over the new budget are kept until evicted.
+  ///
+  /// @param line_bytes The byte budget.
+  ///
+  void line_bytes(std::size_t line_bytes) noexcept { _line_bytes = line_bytes; }
+
+  ///
+  /// @brief Removes all entries.  The counters are kept.
+  ///
+  void clear() noexcept
+  {
+    _entries.clear();
+    _index.clear();
+  }
+
+  ///
+  /// @brief Looks up a sequence of arguments and makes the entry the most
+  ///   recently used one.
+  ///
+  /// @param first, last The arguments.
+  /// @return The cached value, or null if there is no entry or the
+  ///   arguments are over the byte budget.
+  ///
+  const T* find(args_t::const_iterator first, args_t::const_iterator last)
+  {
+    if(_capacity == 0)
+      return nullptr;
+    if(!fits(first, last))
+    {
+      ++_stats.oversized;
+      return nullptr;
+    }
+    auto i = _index.find(hash(first, last));
+    if(i == _index.end() || !std::equal(first, last, i->second->tokens.begin(), i->second->tokens.end()))
+    {
+      ++_stats.misses;
+      return nullptr;
+    }
+    ++_stats.hits;
+    _entries.splice(_entries.begin(), _entries, i->second);
+    return &i->second->value;
+  }
+
+  ///
+  /// @brief Adds an entry, replacing any entry with the same hash.  Nothing
+  ///   is added if the arguments are over the byte budget.
+  ///
+  /// @param first, last The arguments.
+  /// @param value The value.
+  ///
+  void insert(args_t::const_iterator first, args_t::const_iterator last, T value)
+  {
+    if(_capacity == 0 || !fits(first, last))
+      return;
+    auto h = hash(first, last);
+    if(auto i = _index.find(h); i != _index.end())
+    {
+      _entries.erase(i->second);
+      _index.erase(i);
+    }
+    else if(_entries.size() == _capacity)
+      evict();
+    _entries.push_front({h, args_t(first, last), std::move(value)});
+    _index.emplace(h, _entries.begin());
+  }
+
+private:
+  /// @brief A cached value with its key.
+  struct entry_t
+  {
+    std::uint64_t hash;
+    args_t tokens;
+    T value;
+  };
+  /// @brief The maximum number of entries.
+  std::size_t _capacity;
+  /// @brief The maximum total length of the arguments of an entry.
+  std::size_t _line_bytes;
+  /// @brief The entries, most recently used first.
+  std::list<entry_t> _entries;
+  /// @brief Map of hashes to entries.
+  std::unordered_map<std::uint64_t, typename std::list<entry_t>::iterator> _index;
+  /// @brief The counters.
+  cache_stats_t _stats;
+
+  ///
+  /// @brief Removes the least recently used entry.
+  ///
+  void evict()
+  {
+    _index.erase(_entries.back().hash);
+    _entries.pop_back();
+    ++_stats.evictions;
+  }
+
+  ///
+  /// @brief Returns true if the total length of the arguments is within the
+  ///   byte budget.  Stops counting as soon as the budget is exceeded.
+  ///
+  bool fits(args_t::const_iterator first, args_t::const_iterator last) const noexcept
+  {
+    std::size_t bytes = 0;
+    for(; first != last; ++first)
+    {
+      if(first->size() > _line_bytes - bytes)
+        return false;
+      bytes += first->size();
+    }
+    return true;
+  }
+
+  ///
+  /// @brief Hashes a sequence of arguments.  The length of each argument is
+  ///   included so that the boundaries between arguments matter.
+  ///
+  static std::uint64_t hash(args_t::const_iterator first, args_t::const_iterator last) noexcept
+  {
+    std::uint64_t h = fnv1a({});
+    for(; first != last; ++first)
+    {
+      auto size = first->size();
+      h = fnv1a(std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)), fnv1a(*first, h));
+    }
+    return h;
+  }
+};
+
+} // namespace kuri::option
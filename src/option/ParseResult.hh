@@ -0,0 +1,320 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse_args.hh"
+
+namespace kuri::option
+{
+///
+/// @brief The options found by a parse indexed by option id.
+///
+/// @details
+///   Option ids are dense integers assigned by `Program` in the order option
+///   names are first added.  The result holds one bit per id telling whether
+///   the option was present and, for options taking a value, a view of the
+///   value.  The views refer to the parsed arguments, so the arguments must
+///   outlive the result.  If an option is given more than once the last value
+///   is kept.
+///
+///   The result also keeps every occurrence of the options in command line
+///   order, the index of the selected group, and the arguments after the
+///   options.  That's enough for `Program::replay` to execute the callbacks
+///   of a parse again without scanning the arguments, for example in a child
+///   process receiving the result from its parent in the binary form created
+///   by `encode`.
+///
+class ParseResult
+{
+public:
+  /// @brief The magic number at the start of an encoded result ("KOPR").
+  static constexpr std::uint32_t magic = 0x52504f4b;
+  /// @brief The version of the format.
+  static constexpr std::uint32_t version = 1;
+
+  /// @brief An option found, in command line order.
+  struct occurrence_t
+  {
+    /// @brief The option id.
+    option_id id;
+    /// @brief The value, empty for a boolean option.
+    std::string_view value;
+  };
+
+  ///
+  /// @brief Creates an empty result.
+  ///
+  ParseResult() = default;
+
+  ///
+  /// @brief Clears the result and prepares it for the given number of ids.
+  ///
+  /// @param size The number of option ids.
+  ///
+  void reset(std::size_t size)
+  {
+    _present.assign((size + 63) / 64, 0);
+    _values.assign(size, std::string_view());
+    _occurrences.clear();
+    _group = 0;
+    _first = _last = {};
+    _received.clear();
+  }
+
+  ///
+  /// @brief Records that an option was present.
+  ///
+  /// @param id The option id.
+  /// @param value The value of the option, empty for a boolean option.
+  ///
+  void set(option_id id, std::string_view value = {})
+  {
+    _present[id / 64] |= std::uint64_t(1) << (id % 64);
+    _values[id] = value;
+    _occurrences.push_back({id, value});
+  }
+
+  ///
+  /// @brief Records the selected group and the arguments after the options.
+  ///
+  /// @param group The index of the group.
+  /// @param first, last The arguments after the options, which are referred
+  ///   to and not copied.
+  ///
+  void finish(std::size_t group, args_t::iterator first, args_t::iterator last)
+  {
+    _group = group;
+    _first = first;
+    _last = last;
+  }
+
+  ///
+  /// @brief Returns true if the option was present.
+  ///
+  /// @param id The option id.
+  ///
+  bool has(option_id id) const noexcept
+  {
+    return id < _values.size() && (_present[id / 64] & (std::uint64_t(1) << (id % 64))) != 0;
+  }
+
+  ///
+  /// @brief Returns the value of an option.
+  ///
+  /// @param id The option id.
+  /// @return The value or an empty view if the option wasn't present or
+  ///   doesn't take a value.
+  ///
+  std::string_view value(option_id id) const noexcept { return id < _values.size() ? _values[id] : std::string_view(); }
+
+  ///
+  /// @brief Returns the number of option ids.
+  ///
+  std::size_t size() const noexcept { return _values.size(); }
+
+  ///
+  /// @brief Returns the options found in command line order, including
+  ///   repeated options.
+  ///
+  const std::vector<occurrence_t>& occurrences() const noexcept { return _occurrences; }
+
+  ///
+  /// @brief Returns the index of the selected group.
+  ///
+  std::size_t group() const noexcept { return _group; }
+
+  ///
+  /// @brief Returns the arguments after the options.
+  ///
+  std::vector<std::string_view> args() const
+  {
+    if(!_received.empty())
+      return _received;
+    return {_first, _last};
+  }
+
+  ///
+  /// @brief Encodes the result in a binary blob.
+  ///
+  /// @details
+  ///   The blob holds the number of option ids, the occurrences, the group,
+  ///   and the arguments after the options, with the strings copied into the
+  ///   blob and referred to by offset.  It doesn't depend on where it's
+  ///   stored so it can be passed through a pipe, a file, or shared memory.
+  ///   Like a `Schema` the blob uses the byte order of the machine that
+  ///   created it.
+  ///
+  /// @param fingerprint
+  ///   The fingerprint of the program, from `Program::fingerprint`.
+  ///
+  /// @return The blob.
+  ///
+  std::string encode(std::uint64_t fingerprint) const
+  {
+    auto narrow = [](std::size_t n) {
+      if(n > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("ParseResult: result too large to encode");
+      return static_cast<std::uint32_t>(n);
+    };
+    header_t header{};
+    header.magic = magic;
+    header.version = version;
+    header.fingerprint = fingerprint;
+    header.ids = narrow(size());
+    header.group = narrow(_group);
+    header.occurrences = narrow(_occurrences.size());
+    auto args = this->args();
+    header.args = narrow(args.size());
+    header.strings_offset =
+      narrow(sizeof(header_t) + (std::uint64_t(header.occurrences) + header.args) * sizeof(entry_t));
+
+    std::vector<entry_t> entries;
+    entries.reserve(_occurrences.size() + args.size());
+    std::string strings;
+    auto add_string = [&strings, &narrow](std::uint32_t id, std::string_view s) {
+      entry_t entry{id, narrow(strings.size()), narrow(s.size())};
+      strings += s;
+      return entry;
+    };
+    for(auto& [id, value]: _occurrences)
+      entries.push_back(add_string(static_cast<std::uint32_t>(id), value));
+    for(auto arg: args)
+      entries.push_back(add_string(0, arg));
+    header.size = narrow(std::uint64_t(header.strings_offset) + strings.size());
+
+    std::string blob;
+    blob.reserve(header.size);
+    blob.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    blob.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(entry_t));
+    blob += strings;
+    return blob;
+  }
+
+  ///
+  /// @brief Decodes a result encoded by `encode`.
+  ///
+  /// @details
+  ///   The values and the arguments of the result refer to the blob which
+  ///   must outlive the result.  The blob doesn't need to be aligned.
+  ///
+  /// @param blob
+  ///   The blob.
+  /// @param fingerprint
+  ///   The fingerprint of the program, which must be the fingerprint the
+  ///   blob was encoded with.
+  /// @param ids
+  ///   The number of option ids of the program, which must be the number
+  ///   stored in the blob.  The blob is not trusted to size the result.
+  /// @throws std::runtime_error if the blob isn't a valid result of the
+  ///   program.
+  ///
+  /// @return The result.
+  ///
+  static ParseResult decode(std::string_view blob, std::uint64_t fingerprint, std::size_t ids)
+  {
+    auto fail = [](const char* what) { throw std::runtime_error(std::string("ParseResult: ") + what); };
+    header_t header;
+    if(blob.size() < sizeof(header_t))
+      fail("bad blob");
+    std::memcpy(&header, blob.data(), sizeof(header_t));
+    if(header.magic != magic)
+      fail("bad magic number");
+    if(header.version != version)
+      fail("unsupported version");
+    if(header.fingerprint != fingerprint)
+      fail("encoded by a different program");
+    if(header.ids != ids)
+      fail("bad number of option ids");
+    auto entries = std::uint64_t(header.occurrences) + header.args;
+    if(header.size != blob.size() || header.strings_offset != sizeof(header_t) + entries * sizeof(entry_t)
+      || header.strings_offset > header.size)
+      fail("bad table offsets");
+    auto strings = blob.substr(header.strings_offset);
+    auto entry = [&](std::uint32_t i) {
+      entry_t e;
+      std::memcpy(&e, blob.data() + sizeof(header_t) + i * sizeof(entry_t), sizeof(entry_t));
+      if(e.offset > strings.size() || e.size > strings.size() - e.offset)
+        fail("bad string");
+      return e;
+    };
+    ParseResult result;
+    result.reset(header.ids);
+    result._occurrences.reserve(header.occurrences);
+    for(std::uint32_t i = 0; i < header.occurrences; ++i)
+    {
+      auto e = entry(i);
+      if(e.id >= header.ids)
+        fail("bad option id");
+      result.set(e.id, strings.substr(e.offset, e.size));
+    }
+    result._group = header.group;
+    result._received.reserve(header.args);
+    for(std::uint32_t i = 0; i < header.args; ++i)
+    {
+      auto e = entry(header.occurrences + i);
+      result._received.push_back(strings.substr(e.offset, e.size));
+    }
+    return result;
+  }
+
+private:
+  /// @brief The header at the start of an encoded result.
+  struct header_t
+  {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t fingerprint;
+    std::uint32_t size;
+    std::uint32_t ids;
+    std::uint32_t group;
+    std::uint32_t occurrences;
+    std::uint32_t args;
+    std::uint32_t strings_offset;
+  };
+  /// @brief An occurrence or an argument in an encoded result.  The id is
+  ///   zero for arguments.
+  struct entry_t
+  {
+    std::uint32_t id;
+    std::uint32_t offset;
+    std::uint32_t size;
+  };
+
+  /// @brief One bit for each option id.
+  std::vector<std::uint64_t> _present;
+  /// @brief The option values indexed by option id.
+  std::vector<std::string_view> _values;
+  /// @brief The options found in command line order.
+  std::vector<occurrence_t> _occurrences;
+  /// @brief The index of the selected group.
+  std::size_t _group = 0;
+  /// @brief The arguments after the options of a parse.
+  args_t::iterator _first{};
+  /// @brief The end of the arguments after the options of a parse.
+  args_t::iterator _last{};
+  /// @brief The arguments after the options of a decoded result.
+  std::vector<std::string_view> _received;
+};
+
+} // namespace kuri::option
@@ -0,0 +1,164 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include "ConfigFile.hh"
+
+namespace kuri::option
+{
+///
+/// @brief A shared library loaded with `dlopen`.
+///
+/// @details
+///   The library is loaded with `RTLD_NODELETE` so code and data of the
+///   library, for example callbacks stored in a context, remain valid after
+///   the object is destroyed.
+///
+class Plugin
+{
+public:
+  ///
+  /// @brief A command described by a plugin manifest.
+  ///
+  struct entry_t
+  {
+    /// @brief The name of the command.
+    std::string name;
+    /// @brief The path of the shared library.
+    std::filesystem::path library;
+    /// @brief The name of the function implementing the command.
+    std::string symbol;
+  };
+
+  ///
+  /// @brief Loads a shared library.
+  ///
+  /// @param path The path of the library.
+  /// @throws std::runtime_error if the library can't be loaded.
+  ///
+  explicit Plugin(const std::filesystem::path& path)
+    : _path(path),
+      _handle(::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL | RTLD_NODELETE))
+  {
+    if(_handle == nullptr)
+      throw std::runtime_error("Plugin: " + std::string(::dlerror()));
+  }
+  ///
+  /// @brief Releases the handle of the library.
+  ///
+  ~Plugin()
+  {
+    if(_handle != nullptr)
+      ::dlclose(_handle);
+  }
+  ///
+  /// @brief No copying allowed.
+  ///
+  Plugin(const Plugin&) = delete;
+  Plugin& operator=(const Plugin&) = delete;
+  ///
+  /// @brief Move constructor.
+  ///
+  /// @param plugin The plugin to move.
+  ///
+  Plugin(Plugin&& plugin) noexcept
+    : _path(std::move(plugin._path)),
+      _handle(std::exchange(plugin._handle, nullptr))
+  {
+  }
+  ///
+  /// @brief No move assignment.
+  ///
+  Plugin& operator=(Plugin&&) = delete;
+
+  ///
+  /// @brief Returns a function or object defined by the library.
+  ///
+  /// @tparam T The type of the function or object.  The type is not checked.
+  /// @param name The name of the symbol.
+  /// @throws std::runtime_error if the library doesn't define the symbol.
+  ///
+  template<typename T>
+  T* symbol(const std::string& name) const
+  {
+    auto* address = ::dlsym(_handle, name.c_str());
+    if(address == nullptr)
+      throw std::runtime_error("Plugin: " + _path.string() + ": undefined symbol: " + name);
+    return reinterpret_cast<T*>(address);
+  }
+
+  ///
+  /// @brief Reads a manifest describing commands implemented by plugins.
+  ///
+  /// @details
+  ///   The manifest has the format of a `ConfigFile`.  The key is the name of
+  ///   the command and the value is the path of the library, optionally
+  ///   followed by the name of the function.  The name of the function
+  ///   defaults to the name of the command with hyphens replaced by
+  ///   underscores.  A relative path is relative to the directory of the
+  ///   manifest.  The libraries are not loaded.
+  ///
+  /// @code
+  ///   # Commands implemented by plugins.
+  ///   attach = libattach.so
+  ///   start = /usr/lib/tool/libcontrol.so control_start
+  /// @endcode
+  ///
+  /// @param path The path of the manifest.
+  /// @return The commands in the order they appear in the manifest.
+  /// @throws std::system_error if the manifest can't be read.
+  /// @throws std::runtime_error if a line of the manifest is malformed.
+  ///
+  static std::vector<entry_t> manifest(const std::filesystem::path& path)
+  {
+    ConfigFile file(path);
+    std::vector<entry_t> result;
+    result.reserve(file.entries().size());
+    for(const auto& entry: file.entries())
+    {
+      auto end = entry.value.find_first_of(" \t");
+      auto library = entry.value.substr(0, end);
+      auto symbol = end == std::string_view::npos ? std::string_view() : entry.value.substr(end + 1);
+      symbol.remove_prefix(std::min(symbol.find_first_not_of(" \t"), symbol.size()));
+      if(library.empty() || symbol.find_first_of(" \t") != std::string_view::npos)
+        throw std::runtime_error("Plugin: " + path.string() + ": expected library [symbol]: " + std::string(entry.line));
+      entry_t command{std::string(entry.key), path.parent_path() / library, std::string(symbol)};
+      if(command.symbol.empty())
+      {
+        command.symbol = command.name;
+        std::replace(command.symbol.begin(), command.symbol.end(), '-', '_');
+      }
+      result.push_back(std::move(command));
+    }
+    return result;
+  }
+
+private:
+  /// @brief The path of the library.
+  std::filesystem::path _path;
+  /// @brief The handle returned by `dlopen`.
+  void* _handle;
+};
+
+} // namespace kuri::option
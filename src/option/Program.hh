@@ -1,4 +1,4 @@
-// Copyright 2021 Krister Joas
+// Copyright 2021, 2026 Krister Joas
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -14,18 +14,45 @@
 
 #pragma once
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
+#include "ArgStream.hh"
 #include "Option.hh"
+#include "ParseResult.hh"
+#include "StringPool.hh"
+#include "cache_stats.hh"
+#include "compiled.hh"
+#include "forward.hh"
 #include "parse_args.hh"
 #include "string_functions.hh"
 #include "usage.hh"
 
+// The headers only needed by the definitions, which are left out of the
+// translation units using the compiled library.
+#if KURI_OPTION_DEFINITIONS
+#include <filesystem>
+
+#include "ConfigFile.hh"
+#include "Instrumentation.hh"
+#include "ParseCache.hh"
+#include "parallel.hh"
+#include "suggest.hh"
+
+extern char** environ;
+#endif
+
 namespace kuri::option
 {
 ///
@@ -46,9 +73,33 @@ public:
   ///   The name of the program and is used in the usage string.  This
   ///   parameter is optional and if not specified a program name will not be
   ///   included in the usage string.
+  /// @param names
+  ///   The pool holding the option names.  Programs given the same pool
+  ///   store each name they share once.  By default the program has a pool
+  ///   of its own, which is freed with the program.
+  ///
+  Program(std::optional<std::string> program_name = {}, std::shared_ptr<StringPool> names = {});
+  ///
+  /// @brief Destructor.
+  ///
+  ~Program();
+  ///
+  /// @brief Move constructor.
+  ///
+  Program(Program&&);
   ///
-  Program(std::optional<std::string> program_name = {})
-    : _program_name(program_name) {}
+  /// @brief Move assignment operator.
+  ///
+  Program& operator=(Program&&);
+
+  ///
+  /// @brief Returns the pool holding the option names.
+  ///
+  /// @details
+  ///   Pass it to other programs or `Commands` to share the storage of the
+  ///   names, or use it to report their memory use.
+  ///
+  const std::shared_ptr<StringPool>& names() const noexcept { return _names; }
 
   ///
   /// @brief Add a required option to the program.
@@ -67,8 +118,7 @@ public:
   template<typename F>
   Program& required(const std::string& name, F f)
   {
-    _group.valid_options.emplace(name, Option(name, true, f));
-    return *this;
+    return add(name, true, f);
   }
 
   ///
@@ -88,19 +138,389 @@ public:
   template<typename F>
   Program& optional(const std::string& name, F f)
   {
-    _group.valid_options.emplace(name, Option(name, false, f));
+    return add(name, false, f);
+  }
+
+  ///
+  /// @brief Add options to the current group from a table of descriptors.
+  ///
+  /// @details
+  ///   The table is sorted once and checked for duplicate names, both within
+  ///   the table and against the options already in the group, before any
+  ///   option is added.  The options are then inserted in sorted order.  New
+  ///   option names get consecutive ids in table order, so for a program
+  ///   starting with a table the id of an option is its index in the table.
+  ///
+  /// @param first, last
+  ///   The range of option descriptors.
+  /// @throws std::runtime_error if an option name is duplicated.
+  ///
+  Program& options(const OptionSpec* first, const OptionSpec* last);
+
+  ///
+  /// @brief Add options to the current group from an array of descriptors.
+  ///
+  /// @param specs
+  ///   The option descriptors.
+  ///
+  template<std::size_t N>
+  Program& options(const OptionSpec (&specs)[N])
+  {
+    return options(specs, specs + N);
+  }
+
+  ///
+  /// @brief Add options to the current group from an array of descriptors.
+  ///
+  /// @param specs
+  ///   The option descriptors.
+  ///
+  template<std::size_t N>
+  Program& options(const std::array<OptionSpec, N>& specs)
+  {
+    return options(specs.data(), specs.data() + N);
+  }
+
+  ///
+  /// @brief Returns the id of an option name.
+  ///
+  /// @details
+  ///   Ids are assigned in the order option names are first added to the
+  ///   program, starting with zero.  The same name in different groups has the
+  ///   same id.  The id is used to query a `ParseResult`.
+  ///
+  /// @param name
+  ///   The name of the option.
+  /// @return The option id.
+  ///
+  option_id id(std::string_view name) const
+  {
+    auto i = _ids.find(name);
+    if(i == _ids.end())
+      throw std::runtime_error("Program::id: unknown option: " + std::string(name));
+    return i->second;
+  }
+
+  ///
+  /// @brief Declare that the callback of an option depends on the callbacks
+  ///   of other options in the current group.
+  ///
+  /// @details
+  ///   When options with dependencies are given on the command line their
+  ///   callbacks are executed after the callbacks of the options they depend
+  ///   on, regardless of the order on the command line.  Dependencies on
+  ///   options which are not given on the command line are ignored.
+  ///
+  /// @param name
+  ///   The name of an option already added to the current group.
+  /// @param dependencies
+  ///   The names of the options the option depends on, which must also be
+  ///   in the current group.
+  /// @throws std::runtime_error if any of the options isn't in the current
+  ///   group.
+  ///
+  Program& depends(const std::string& name, const std::vector<std::string>& dependencies);
+
+  ///
+  /// @brief Let an environment variable provide the value of an option in
+  ///   the current group when the option isn't on the command line.
+  ///
+  /// @details
+  ///   An option given on the command line takes precedence over its
+  ///   environment variable.  Otherwise, if the variable is set, the option
+  ///   is treated as given after the options on the command line: its value
+  ///   is checked, it satisfies required options and constraints, and its
+  ///   callback is executed.  An option without a value is given if the
+  ///   variable is set to anything but an empty string, "0", or "false".  The
+  ///   values refer to the environment and are not copied, except into
+  ///   `Option::value` before the callback is executed.
+  ///
+  /// @param name
+  ///   The name of an option already added to the current group.
+  /// @param variable
+  ///   The name of the environment variable.
+  ///
+  Program& env(const std::string& name, const std::string& variable);
+
+  ///
+  /// @brief Add a configuration file providing values for options which are
+  ///   not on the command line.
+  ///
+  /// @details
+  ///   Files added later take precedence over files added earlier, so a
+  ///   typical program adds a system file, then a user file, and then a
+  ///   project file.  The command line and environment variables given with
+  ///   `env` take precedence over all files.  The keys in the file are the
+  ///   option names without the leading double hyphen and apply to any group
+  ///   with an option of that name.  Keys not naming an option are ignored.
+  ///   An option without a value is given unless its value is empty, "0", or
+  ///   "false".  Otherwise options from a file are treated the same as
+  ///   options from the environment.
+  ///
+  ///   The files are read when parsing.  A file which doesn't exist is
+  ///   skipped.  Files are memory mapped and the parsed form is cached until
+  ///   the file changes, see `ConfigFile::load`.
+  ///
+  /// @param path
+  ///   The path of the configuration file.  A `std::filesystem::path`
+  ///   converts to it implicitly.
+  ///
+  Program& config(std::string path);
+
+  ///
+  /// @brief Add a check of the value of an option in the current group.
+  ///
+  /// @details
+  ///   The predicate is called with the value of each occurrence of the
+  ///   option before any callback is executed, both when parsing and when
+  ///   validating.  If it returns false the group fails with the error
+  ///   "invalid option value".
+  ///
+  /// @param name
+  ///   The name of an option taking a value already added to the current
+  ///   group.
+  /// @param predicate
+  ///   Returns true if the value is valid.
+  ///
+  Program& check(const std::string& name, std::function<bool(std::string_view)> predicate);
+
+  ///
+  /// @brief Declare that at most one of the options in the current group may
+  ///   be given.
+  ///
+  /// @details
+  ///   Constraints are checked after the options of a group have been
+  ///   scanned and before any callback is executed.  A violated constraint
+  ///   makes the group fail, naming the options involved, and the next group
+  ///   is tried.  At most 64 options in a group can take part in constraints.
+  ///
+  /// @param names
+  ///   Names of options already added to the current group.
+  ///
+  Program& exclusive(const std::vector<std::string>& names)
+  {
+    return constrain(constraint_t::exclusive, 0, names);
+  }
+
+  ///
+  /// @brief Declare that if an option in the current group is given then all
+  ///   of the other options must be given as well.
+  ///
+  /// @param name
+  ///   The name of an option already added to the current group.
+  /// @param names
+  ///   Names of the options required by the option.
+  ///
+  Program& implies(const std::string& name, const std::vector<std::string>& names)
+  {
+    return constrain(constraint_t::implies, constraint_bit(name), names);
+  }
+
+  ///
+  /// @brief Declare that at least one of the options in the current group
+  ///   must be given.
+  ///
+  /// @param names
+  ///   Names of options already added to the current group.
+  ///
+  Program& at_least_one(const std::vector<std::string>& names)
+  {
+    return constrain(constraint_t::at_least_one, 0, names);
+  }
+
+  ///
+  /// @brief Set the maximum number of threads executing option callbacks.
+  ///
+  /// @details
+  ///   With a concurrency greater than one the callbacks of options which
+  ///   don't depend on each other are executed concurrently.  The callbacks
+  ///   are executed in stages where each stage contains the options whose
+  ///   dependencies were all executed in earlier stages.  If any callback
+  ///   throws an exception the remaining stages are not executed and once the
+  ///   stage is complete the exception of the earliest failing option on the
+  ///   command line is rethrown.
+  ///
+  /// @param concurrency
+  ///   Maximum number of threads.  Zero means the number of hardware threads
+  ///   and one, the default, means the callbacks are executed sequentially.
+  ///
+  Program& concurrency(unsigned concurrency)
+  {
+    _concurrency = concurrency;
     return *this;
   }
 
   ///
-  /// @brief Start a new group of options.
+  /// @brief Accept unique prefixes of long options.
+  ///
+  /// @details
+  ///   When enabled an argument such as `--verb` or `--verb=value` which is
+  ///   not the name of an option in the group, but a prefix of exactly one
+  ///   option name starting with a double hyphen, is treated as that option.
+  ///   A prefix of more than one option name is an "ambiguous option" error
+  ///   listing the candidates.  Exact option names always take precedence.
+  ///   Abbreviations are disabled by default.
+  ///
+  /// @param enable True to accept abbreviations.
+  ///
+  Program& abbreviations(bool enable = true);
+
+  ///
+  /// @brief Memoize the outcome of `parse` for repeated command lines.
+  ///
+  /// @details
+  ///   When enabled `parse` looks up the arguments in a cache of recently
+  ///   parsed command lines.  On a hit the options found the first time are
+  ///   restored, with their values referring to the new arguments, and only
+  ///   the callbacks and argument handlers are executed.  On a miss the
+  ///   arguments are parsed as usual and the outcome is cached if the parse
+  ///   succeeds.  The least recently used command line is evicted when the
+  ///   cache is full.  Each entry holds a copy of the arguments and one
+  ///   small record per option found.  Command lines longer than the byte
+  ///   budget are parsed as usual but not cached, so the cache holds at most
+  ///   `capacity` times `line_bytes` bytes of arguments.
+  ///
+  ///   The cache is bypassed when the outcome may depend on anything but the
+  ///   arguments: when configuration files or environment variables are
+  ///   used and in explain mode.  Adding options, groups, checks, or
+  ///   constraints clears the cache.  Option checks must be pure functions
+  ///   of the value since they are not called again on a hit.
+  ///
+  /// @param capacity
+  ///   Maximum number of command lines kept.  Zero, the default, disables the
+  ///   cache.
+  /// @param line_bytes
+  ///   Maximum total length of the arguments of a cached command line.
+  ///
+  Program& cache(std::size_t capacity, std::size_t line_bytes = 4096);
+
+  ///
+  /// @brief Returns the hit, miss, eviction, and oversized counters of the
+  ///   cache.
+  ///
+  const cache_stats_t& cache_stats() const noexcept;
+
+  ///
+  /// @brief Bounds on the size of the arguments accepted by a program.
+  ///
+  /// @details
+  ///   The default of each limit is no limit.
+  ///
+  struct limits_t
+  {
+    /// @brief Maximum number of arguments, including those after the options.
+    std::size_t tokens = std::numeric_limits<std::size_t>::max();
+    /// @brief Maximum length of one argument.
+    std::size_t token_length = std::numeric_limits<std::size_t>::max();
+    /// @brief Maximum length of an option value, including values from
+    ///   environment variables and configuration files.
+    std::size_t value_length = std::numeric_limits<std::size_t>::max();
+    /// @brief Maximum number of elements of a `numeric_range` expansion.
+    ///   Not enforced by the program itself but meant to be passed to
+    ///   `numeric_range` by option callbacks.
+    std::size_t range_size = std::numeric_limits<std::size_t>::max();
+  };
+
+  ///
+  /// @brief Set limits on the size of the arguments, for parsing input from
+  ///   untrusted sources.
+  ///
+  /// @details
+  ///   The number of arguments and their lengths are checked before any
+  ///   group is tried and option values are checked as they are scanned.
+  ///   Exceeding a limit stops the parse at once, without trying the
+  ///   remaining groups or building a usage message, by throwing an
+  ///   `argument_error` with the code `error_code::limit_exceeded`.
+  ///   `validate` returns the error message instead.  The time and memory
+  ///   spent on arguments within the limits is linear in their size.
+  ///
+  /// @param limits The new limits.
+  ///
+  Program& limits(const limits_t& limits);
+
+  ///
+  /// @brief Returns the limits on the size of the arguments.
+  ///
+  const limits_t& limits() const noexcept { return _limits; }
+
+  ///
+  /// @brief Report counters and callback timing to an instrumentation
+  ///   object.
+  ///
+  /// @details
+  ///   Has no effect unless the library is compiled with
+  ///   `KURI_OPTION_INSTRUMENTATION` defined.  Without it the measurements
+  ///   are not compiled in and cost nothing.  `validate` and `complete` are
+  ///   not instrumented.
+  ///
+  /// @param instrumentation
+  ///   The object receiving the measurements which must outlive the
+  ///   program, or null to stop reporting.
+  ///
+  Program& instrument(Instrumentation* instrumentation)
+  {
+    _instrumentation = instrumentation;
+    return *this;
+  }
+
+  ///
+  /// @brief The outcome of trying one group of options.
+  ///
+  struct decision_t
+  {
+    /// @brief The index of the group in the order the groups were defined.
+    std::size_t group;
+    /// @brief The reason the group was rejected, or `error_code::none` if it
+    ///   was selected.
+    error_code code;
+    /// @brief The index of the argument causing the rejection, counted from
+    ///   the start of the parsed range, or `argument_error::no_token`.  For a
+    ///   selected group it's the index of the first argument after the
+    ///   options.
+    std::size_t token;
+    /// @brief The error message, empty for a selected group.
+    std::string message;
+  };
+
+  ///
+  /// @brief Record why each group was selected or rejected.
+  ///
+  /// @details
+  ///   When enabled `parse` and `stream` record one `decision_t` for each
+  ///   group tried.  The record of the previous parse is replaced.  Errors in
+  ///   the number of arguments found by an `ArgStream` after the options are
+  ///   not recorded.  With explain mode disabled, the default, nothing is
+  ///   recorded.
+  ///
+  /// @param enable True to enable explain mode.
   ///
-  Program& group()
+  Program& explain(bool enable = true)
   {
-    _groups.push_back(std::move(_group));
+    _explain = enable;
     return *this;
   }
 
+  ///
+  /// @brief Returns the decisions recorded by the last parse in explain mode.
+  ///
+  const std::vector<decision_t>& decisions() const noexcept { return _decisions; }
+
+  ///
+  /// @brief Formats the decisions recorded by the last parse, one line per
+  ///   group.
+  ///
+  /// @param first, last
+  ///   The range of arguments given to the last parse, used to show the
+  ///   arguments causing the rejections.
+  /// @return The explanation.
+  ///
+  std::string explanation(args_t::iterator first, args_t::iterator last) const;
+
+  ///
+  /// @brief Start a new group of options.
+  ///
+  Program& group();
+
   ///
   /// @brief Creates a group representing the arguments after all options.
   ///
@@ -136,6 +556,43 @@ public:
     return group();
   }
 
+  ///
+  /// @brief Type of the function called for each argument after the options.
+  ///
+  using arg_handler_t = std::function<void(const std::string&)>;
+
+  ///
+  /// @brief Creates a group representing the arguments after all options
+  ///   where each argument is processed by a handler function.
+  ///
+  /// @details
+  ///   Same as the two argument version of `args` except that once `parse`
+  ///   has executed the option callbacks it calls the handler for each of the
+  ///   arguments after the options.  The handlers are called on up to
+  ///   `concurrency` threads.  If a handler throws an exception no handlers
+  ///   for later arguments are started and the exception of the earliest
+  ///   failing argument is rethrown from `parse`.  The handler is not called
+  ///   by `stream`.
+  ///
+  /// @param min_args
+  ///   Minimum number of arguments.
+  /// @param max_args
+  ///   Maximum number of arguments.
+  /// @param handler
+  ///   The function called for each argument.
+  /// @param concurrency
+  ///   Maximum number of threads calling the handler.  Zero means the number
+  ///   of hardware threads.  The default is one which calls the handler for
+  ///   each argument in order.
+  ///
+  Program& args(std::optional<int> min_args, std::optional<int> max_args, arg_handler_t handler,
+    unsigned concurrency = 1)
+  {
+    _group.handler = std::move(handler);
+    _group.concurrency = concurrency;
+    return args(min_args, max_args);
+  }
+
   ///
   /// @brief Parse the arguments.
   ///
@@ -152,22 +609,158 @@ public:
   ///
   args_t::iterator parse(args_t::iterator first, args_t::iterator last)
   {
-    _groups.push_back(std::move(_group));
-    for(auto& group: _groups)
-    {
-      try
-      {
-        return parse(first, last, group);
-      }
-      catch(const argument_error& e)
-      {
-        _errors.push_back(e.what());
-      }
-    }
-    usage();
-    throw;
+    return parse(first, last, nullptr);
+  }
+
+  ///
+  /// @brief Parse the arguments and record the options found.
+  ///
+  /// @details
+  ///   Same as the two argument version of `parse` but in addition the options
+  ///   of the selected group which are present on the command line are
+  ///   recorded in the result, indexed by their option id.  The option values
+  ///   in the result refer to the range of arguments.
+  ///
+  /// @param first, last
+  ///   The range of elements to parse.
+  /// @param result
+  ///   The options found are recorded here.
+  /// @return Returns the first iterator which is not an option.
+  ///
+  args_t::iterator parse(args_t::iterator first, args_t::iterator last, ParseResult& result)
+  {
+    return parse(first, last, &result);
   }
 
+  ///
+  /// @brief Check the arguments without executing any callbacks.
+  ///
+  /// @details
+  ///   Groups are selected in the same way as in `parse`, including the
+  ///   checks of required options, option values, and the number of
+  ///   arguments after the options, but no option callbacks or argument
+  ///   handlers are executed and the state of the program is not changed.  A
+  ///   successful validation doesn't allocate memory for programs with up to
+  ///   256 option names and no configuration files, whichever group is
+  ///   selected.  It's safe to validate concurrently from multiple threads
+  ///   as long as the program isn't modified.
+  ///
+  /// @param first, last
+  ///   The range of elements to validate.
+  /// @return Nothing if the arguments are valid.  Otherwise the first error
+  ///   found in any group, or "wrong number of arguments" if the options of
+  ///   the first group are valid but the number of arguments after the
+  ///   options isn't.
+  ///
+  std::optional<std::string> validate(args_t::iterator first, args_t::iterator last) const;
+
+  ///
+  /// @brief Parse the options and return the arguments after the options as
+  ///   a stream.
+  ///
+  /// @details
+  ///   Groups are selected in the same way as in `parse` but the number of
+  ///   arguments after the options is not counted up front.  Instead the
+  ///   returned `ArgStream` checks the minimum and maximum number of arguments
+  ///   of the selected group as the arguments are pulled.  This means the
+  ///   option callbacks are executed before any error in the number of
+  ///   arguments is detected.  The `Program` object must outlive the stream.
+  ///
+  /// @param first, last
+  ///   The range of elements to parse.
+  /// @return A stream of the arguments following the options.
+  ///
+  ArgStream stream(args_t::iterator first, args_t::iterator last);
+
+  ///
+  /// @brief Parse the options and return the arguments after the options
+  ///   followed by the arguments read from an input stream.
+  ///
+  /// @details
+  ///   Like the two argument version of `stream` except that when the
+  ///   arguments in the range are exhausted further arguments are read from
+  ///   the input stream.  Each argument in the input stream is terminated by
+  ///   the delimiter, for example a newline or a NUL character.
+  ///
+  /// @param first, last
+  ///   The range of elements to parse.
+  /// @param is
+  ///   The input stream which must outlive the returned stream.
+  /// @param delim
+  ///   The delimiter character.
+  /// @return A stream of the arguments following the options.
+  ///
+  ArgStream stream(args_t::iterator first, args_t::iterator last, std::istream& is, char delim = '\n');
+
+  ///
+  /// @brief Returns a hash of the groups and options of the program.
+  ///
+  /// @details
+  ///   Two programs have the same fingerprint if they have the same groups
+  ///   with the same options, option ids, and numbers of arguments, which
+  ///   is the case when they are built by the same code.  The fingerprint
+  ///   is stored in an encoded `ParseResult` to make sure it's decoded by the
+  ///   same program.
+  ///
+  std::uint64_t fingerprint() const;
+
+  ///
+  /// @brief Decodes a result encoded by this program or an identical one.
+  ///
+  /// @param blob
+  ///   The blob returned by `ParseResult::encode`, which must outlive the
+  ///   result.
+  /// @throws std::runtime_error if the blob isn't a valid result of the
+  ///   program.
+  ///
+  ParseResult decode(std::string_view blob) const;
+
+  ///
+  /// @brief Execute the callbacks of a parse recorded in a result.
+  ///
+  /// @details
+  ///   The options of the result are set and their callbacks executed, then
+  ///   the argument handler of the selected group is called for the
+  ///   arguments after the options, as if the arguments had been parsed
+  ///   again.  Nothing is scanned or looked up by name and the options are
+  ///   not checked again.  This lets a parent process parse a command line
+  ///   once and hand the result to child processes, which can't use the
+  ///   parent's objects:
+  ///
+  /// @code
+  ///   // Parent
+  ///   ParseResult result;
+  ///   program.parse(args.begin(), args.end(), result);
+  ///   auto blob = result.encode(program.fingerprint());
+  ///   // Child, with a program built the same way
+  ///   auto received = program.decode(blob);
+  ///   program.replay(received);
+  /// @endcode
+  ///
+  /// @param result
+  ///   The result, recorded by `parse` of this program or an identical one.
+  ///   The values of the options refer to the result's storage.
+  /// @throws std::runtime_error if the result doesn't match the program.
+  ///
+  void replay(const ParseResult& result);
+
+  ///
+  /// @brief Returns the completion candidates for a partial command line.
+  ///
+  /// @details
+  ///   The last word in the range is the word being completed, possibly
+  ///   empty.  If it's an option, or the start of one, the candidates are the
+  ///   option names in any group starting with the word.  There are no
+  ///   candidates if the word is expected to be an option value or an
+  ///   argument after the options.  No callbacks are executed.
+  ///
+  /// @param first, last
+  ///   The words of the command line up to and including the word being
+  ///   completed.
+  /// @return The sorted candidates.
+  ///
+  std::vector<std::string> complete(args_t::iterator first, args_t::iterator last) const;
+
   ///
   /// @brief Construct the help string.
   ///
@@ -175,67 +768,184 @@ public:
   ///   group.  No consideration is given to the width of the generated help
   ///   strings.
   ///
-  std::vector<std::string> help()
-  {
-    std::vector<std::string> help_strings;
-    for(auto& g: _groups)
-    {
-      std::string help;
-      bool first = true;
-      if(_program_name)
-      {
-        first = false;
-        help = *_program_name;
-      }
-      for(auto& [key, o]: g.valid_options)
-      {
-        if(first)
-          first = false;
-        else
-          help += " ";
-        help += o.help();
-      }
-      if(g.min_args)
-      {
-        auto min_args = *g.min_args;
-        for(auto i = 1; i <= min_args; ++i)
-          help += " <arg>";
-        if(g.max_args)
-        {
-          if(*g.max_args > min_args)
-          {
-            help += " [";
-            int first = 0;
-            for(auto i = *g.min_args; i < *g.max_args; ++i)
-            {
-              if(first > 0)
-                help += " [";
-              ++first;
-              help += "<arg>";
-            }
-            help += std::string(first, ']');
-          }
-        }
-        else
-          help += " [<arg>...]";
-      }
-      help_strings.push_back(help);
-    }
-    return help_strings;
-  }
+  std::vector<std::string> help();
 
   ///
   /// @brief Construct the usage string based on what groups there are and what
   ///   options there are in each group.
   ///
-  void usage()
-  {
-    if(_errors.empty())
-      option::usage(help());
-    option::usage(Error(_errors), help());
-  }
+  void usage();
 
 private:
+  friend class Schema;
+
+  ///
+  /// @brief A set of option ids.
+  ///
+  /// @details
+  ///   The bits are kept inside the object, without allocating memory, unless
+  ///   the program has more than 256 option names.
+  ///
+  class id_set
+  {
+  public:
+    ///
+    /// @brief Creates an empty set.
+    ///
+    /// @param size The number of option ids.
+    ///
+    explicit id_set(std::size_t size)
+    {
+      if(size > inline_bits)
+      {
+        _heap.resize((size + 63) / 64);
+        _bits = _heap.data();
+      }
+    }
+    ///
+    /// @brief No copying allowed.
+    ///
+    id_set(const id_set&) = delete;
+    id_set& operator=(const id_set&) = delete;
+
+    ///
+    /// @brief Returns true if an id is in the set.
+    ///
+    bool test(option_id id) const noexcept { return (_bits[id / 64] & (std::uint64_t(1) << (id % 64))) != 0; }
+    ///
+    /// @brief Adds an id to the set.
+    ///
+    void set(option_id id) noexcept { _bits[id / 64] |= std::uint64_t(1) << (id % 64); }
+
+  private:
+    /// @brief Number of ids kept inside the object.
+    static constexpr std::size_t inline_bits = 256;
+    /// @brief The bits when kept inside the object.
+    std::array<std::uint64_t, inline_bits / 64> _inline{};
+    /// @brief The bits when there are too many ids.
+    std::vector<std::uint64_t> _heap;
+    /// @brief The bits in use.
+    std::uint64_t* _bits = _inline.data();
+  };
+
+  ///
+  /// @brief The entries of the environment setting a variable registered
+  ///   with `env`, in the order of the environment.
+  ///
+  /// @details
+  ///   The environment is resolved once per parse so that each group only
+  ///   looks at the registered variables which are set.  Up to 16 entries
+  ///   are kept inside the object, more than that are kept in allocated
+  ///   memory.
+  ///
+  class environment_t
+  {
+  public:
+    ///
+    /// @brief Adds an entry.
+    ///
+    /// @param entry The whole environment entry, "NAME=value".
+    ///
+    void push_back(std::string_view entry)
+    {
+      if(_size < _inline.size())
+        _inline[_size] = entry;
+      else
+      {
+        if(_size == _inline.size())
+          _heap.assign(_inline.begin(), _inline.end());
+        _heap.push_back(entry);
+      }
+      ++_size;
+    }
+    /// @brief Returns the first entry.
+    const std::string_view* begin() const noexcept { return _size <= _inline.size() ? _inline.data() : _heap.data(); }
+    /// @brief Returns the end of the entries.
+    const std::string_view* end() const noexcept { return begin() + _size; }
+
+  private:
+    /// @brief The entries when there are few of them.
+    std::array<std::string_view, 16> _inline{};
+    /// @brief All the entries when there are too many.
+    std::vector<std::string_view> _heap;
+    /// @brief The number of entries.
+    std::size_t _size = 0;
+  };
+
+  ///
+  /// @brief A constraint on the options of a group.
+  ///
+  /// @details
+  ///   The options are represented by their constraint bits so a constraint
+  ///   is checked with a few mask operations on the set of options present.
+  ///
+  struct constraint_t
+  {
+    enum kind_t
+    {
+      exclusive,
+      implies,
+      at_least_one
+    };
+    /// @brief The kind of constraint.
+    kind_t kind;
+    /// @brief The option which requires the other options in an `implies`
+    ///   constraint.
+    std::uint64_t trigger = 0;
+    /// @brief The options of the constraint.
+    std::uint64_t options = 0;
+  };
+
+  ///
+  /// @brief The constraint bits of the options present in a parse, with the
+  ///   token where each of them first appeared.
+  ///
+  struct presence_t
+  {
+    /// @brief The constraint bits of the options present.
+    std::uint64_t bits = 0;
+    /// @brief The token of each option present, indexed by constraint bit
+    ///   number.
+    std::array<std::size_t, 64> tokens;
+
+    ///
+    /// @brief Records an option as present.
+    ///
+    /// @param o The option.
+    /// @param token The index of its argument, or `argument_error::no_token`.
+    ///
+    void mark(const Option* o, std::size_t token) noexcept
+    {
+      if(o->constraint_bit == 0 || (bits & o->constraint_bit) != 0)
+        return;
+      bits |= o->constraint_bit;
+      std::size_t i = 0;
+      while((std::uint64_t(1) << i) != o->constraint_bit)
+        ++i;
+      tokens[i] = token;
+    }
+
+    ///
+    /// @brief Returns the token of the first option of a violated
+    ///   constraint: the first of the conflicting options, or the option
+    ///   requiring the others.  Returns `argument_error::no_token` if the
+    ///   constraint is violated by options missing.
+    ///
+    std::size_t token(const constraint_t& c) const noexcept
+    {
+      std::uint64_t options = 0;
+      if(c.kind == constraint_t::exclusive)
+        options = bits & c.options;
+      else if(c.kind == constraint_t::implies)
+        options = c.trigger;
+      auto result = argument_error::no_token;
+      for(std::size_t i = 0; i < tokens.size(); ++i)
+        if((options & (std::uint64_t(1) << i)) != 0)
+          result = std::min(result, tokens[i]);
+      return result;
+    }
+  };
+
   ///
   /// @brief A Group represents a group of options which can optionally take a
   ///   number of arguments after the sequence of options.
@@ -260,11 +970,21 @@ private:
     ///
     /// @param g The group to move.
     ///
-    Group(Group&& g) : min_args(g.min_args), max_args(g.max_args), valid_options(std::move(g.valid_options))
+    Group(Group&& g)
+      : min_args(g.min_args),
+        max_args(g.max_args),
+        handler(std::move(g.handler)),
+        concurrency(g.concurrency),
+        valid_options(std::move(g.valid_options)),
+        constraints(std::move(g.constraints)),
+        constrained(std::move(g.constrained)),
+        environment(std::move(g.environment))
     {
       // Default move constructor doesn't reset these members.
       g.min_args = {};
       g.max_args = {};
+      g.handler = nullptr;
+      g.concurrency = 1;
     }
     ///
     /// @brief Move assignment operator.
@@ -278,9 +998,16 @@ private:
       {
         min_args = g.min_args;
         max_args = g.max_args;
+        handler = std::move(g.handler);
+        concurrency = g.concurrency;
         valid_options = std::move(g.valid_options);
+        constraints = std::move(g.constraints);
+        constrained = std::move(g.constrained);
+        environment = std::move(g.environment);
         g.min_args = {};
         g.max_args = {};
+        g.handler = nullptr;
+        g.concurrency = 1;
       }
       return *this;
     }
@@ -290,157 +1017,1643 @@ private:
     std::optional<int> min_args;
     /// @brief Maximum number of arguments, or zero which means no limit.
     std::optional<int> max_args;
-    using valid_options_t = std::map<std::string, Option>;
+    /// @brief Optional function called for each argument after the options.
+    arg_handler_t handler;
+    /// @brief Maximum number of threads calling the handler.
+    unsigned concurrency = 1;
+    using valid_options_t = std::map<std::string_view, Option, std::less<>>;
     /// @brief Map of option strings (with the double hyphen prefix) to Option
-    ///   objects.
+    ///   objects.  The keys are interned in the program's `StringPool`.
     valid_options_t valid_options;
+    /// @brief The constraints on the options of the group.
+    std::vector<constraint_t> constraints;
+    /// @brief Names of the options taking part in constraints, indexed by
+    ///   constraint bit number.
+    std::vector<std::string_view> constrained;
+    /// @brief Map of environment variable names to the options they provide
+    ///   a value for.  The names are interned in the program's `StringPool`.
+    std::unordered_map<std::string_view, Option*> environment;
+  };
+
+  ///
+  /// @brief The outcome of a successful parse kept in the cache.
+  ///
+  struct memo_t
+  {
+    /// @brief An option found, with the position of its value in the
+    ///   arguments.
+    struct occurrence_t
+    {
+      Option* option;
+      /// @brief The index of the argument containing the value, or
+      ///   `argument_error::no_token` if there is no value.
+      std::size_t token;
+      std::size_t offset;
+      std::size_t length;
+    };
+    /// @brief The index of the selected group.
+    std::size_t group = 0;
+    /// @brief The options found in command line order.
+    std::vector<occurrence_t> options;
+    /// @brief The index of the first argument after the options.
+    std::size_t rest = 0;
   };
 
+  /// @brief The pool holding the option names.  Declared first so that it
+  ///   outlives all the views of the names.
+  std::shared_ptr<StringPool> _names;
   /// @brief The optional name of the program.  Used in the usage string.
   std::optional<std::string> _program_name;
   /// @brief List of groups to consider when parsing.
   std::vector<Group> _groups;
   /// @brief The current group.
   Group _group;
+  /// @brief True if the current group has been added to the list of groups
+  ///   by a parse and not changed since.
+  bool _added = false;
+  /// @brief Map of option names to option ids.
+  std::map<std::string_view, option_id, std::less<>> _ids;
+  /// @brief Maximum number of threads executing option callbacks.
+  unsigned _concurrency = 1;
+  /// @brief Paths of the configuration files in order of increasing
+  ///   precedence.
+  std::vector<std::string> _config;
+  /// @brief The configuration files loaded by the last parse.  They are kept
+  ///   because option values and `ParseResult` values may refer to them.
+  std::vector<std::shared_ptr<const ConfigFile>> _config_files;
+  /// @brief True if any option falls back to an environment variable.
+  bool _environment = false;
+  /// @brief True if unique prefixes of long options are accepted.
+  bool _abbreviations = false;
+  /// @brief True if the outcome of each group is recorded.
+  bool _explain = false;
+  /// @brief The outcome of each group tried by the last parse.
+  std::vector<decision_t> _decisions;
+  /// @brief Receives measurements if instrumentation is compiled in.
+  Instrumentation* _instrumentation = nullptr;
+  /// @brief The state of a program whose types are only needed by the
+  ///   definitions.  It's kept out of line so that the translation units
+  ///   using the compiled library don't need their headers.
+  struct state_t;
+  /// @brief The state kept out of line.
+  std::unique_ptr<state_t> _state;
+  /// @brief Bounds on the size of the arguments.
+  limits_t _limits;
   /// @brief List of errors while processing groups.  There may be up to the
   ///   number of groups number of errors in this list.
   std::vector<std::string> _errors;
 
+  ///
+  /// @brief Construct the help string of one group.
+  ///
+  /// @param g The group.
+  /// @return The help string.
+  ///
+  std::string help(const Group& g) const;
+
+  ///
+  /// @brief Options given on the command line, in order, together with their
+  ///   values.
+  ///
+  using occurrences_t = std::vector<std::pair<Option*, std::string_view>>;
+
+  ///
+  /// @brief Add an option to the current group.
+  ///
+  /// @param name The name of the option.
+  /// @param required True if the option is required.
+  /// @param f The callback function.
+  ///
+  template<typename F>
+  Program& add(const std::string& name, bool required, F f)
+  {
+    auto key = _names->intern(name);
+    auto id = _ids.emplace(key, _ids.size()).first->second;
+    auto o = _group.valid_options.emplace(key, Option(key, required, f));
+    o.first->second.id = id;
+    changed();
+    return *this;
+  }
+
   ///
   /// @brief Find an option in a group.
   ///
   /// @param arg The option argument to search for.
   /// @param group The option group to search.
   ///
-  /// @return An optional pair of an iterator to the Option found as well as an
-  ///   optional option value.
+  /// @return An optional pair of a pointer to the Option found as well as an
+  ///   optional option value.  The value refers to the argument.
+  ///
+  std::optional<std::pair<const Option*, std::optional<std::string_view>>> find_option(std::string_view arg,
+    const Group& group) const;
+
+  ///
+  /// @brief Returns the range of long options in a group starting with an
+  ///   abbreviation.
+  ///
+  /// @details
+  ///   The options are sorted so the options starting with the abbreviation
+  ///   are found with a binary search followed by a check of the following
+  ///   option names.  Only the first two matches are looked at unless `all`
+  ///   is true.
+  ///
+  /// @param name The abbreviated option name without any value.
+  /// @param group The group.
+  /// @param all True to find all matches, false to stop after two.
+  /// @return The range of matching options.
+  ///
+  static std::pair<Group::valid_options_t::const_iterator, Group::valid_options_t::const_iterator> abbreviated(
+    std::string_view name, const Group& group, bool all = false);
+
+  ///
+  /// @brief Returns the error message for an ambiguous abbreviation.
+  ///
+  /// @param arg The abbreviated option, possibly followed by `=value`.
+  /// @param group The group.
+  /// @return The message listing the candidates, or an empty string if the
+  ///   option isn't an ambiguous abbreviation.
+  ///
+  std::string ambiguity(std::string_view arg, const Group& group) const;
+
+  ///
+  /// @brief Returns true if an option is an ambiguous abbreviation.  Unlike
+  ///   `ambiguity` it doesn't allocate memory.
+  ///
+  /// @param arg The abbreviated option, possibly followed by `=value`.
+  /// @param group The group.
+  ///
+  bool ambiguous(std::string_view arg, const Group& group) const;
+
+  ///
+  /// @brief Find an option in a group.  Non-const version of the above.
   ///
-  std::optional<std::pair<Group::valid_options_t::iterator, std::optional<std::string>>> find_option(
-    const std::string& arg, Group& group)
+  std::optional<std::pair<Option*, std::optional<std::string_view>>> find_option(std::string_view arg, Group& group)
   {
-    auto o = [](std::optional<std::string> s = {}) { return s; };
-    auto opt = group.valid_options.find(arg);
-    if(opt != group.valid_options.end())
-      return std::make_pair(opt, o());
-    auto pos = arg.find_first_of('=');
-    if(pos == std::string::npos)
-      return {};
-    auto left = arg.substr(0, pos);
-    auto right = arg.substr(pos + 1);
-    opt = group.valid_options.find(left);
-    if(opt != group.valid_options.end())
-      return std::make_pair(opt, o(right));
+    if(auto opt = std::as_const(*this).find_option(arg, std::as_const(group)); opt)
+      return std::make_pair(const_cast<Option*>(opt->first), opt->second);
     return {};
   }
 
   ///
-  /// @brief Parse the range of arguments against the option group.
+  /// @brief Find an option in a group while parsing, counting the lookup.
+  ///
+  std::optional<std::pair<Option*, std::optional<std::string_view>>> lookup(std::string_view arg, Group& group);
+
+  ///
+  /// @brief Reports the counters and the duration of a parse to the
+  ///   instrumentation when it goes out of scope.
+  ///
+  class report_t;
+
+  ///
+  /// @brief Suggest the option in a group nearest to an unknown option.
+  ///
+  /// @param arg The unknown option, possibly followed by `=value`.
+  /// @param group The group.
+  /// @return The nearest option if there is exactly one within reach,
+  ///   otherwise an empty string.
+  ///
+  static std::string_view suggest(std::string_view arg, const Group& group);
+
+  ///
+  /// @brief Check the value of an option with the option's predicate.
+  ///
+  /// @param o The option.
+  /// @param value The value.
+  /// @return True if the option has no predicate or the value is valid.
+  ///
+  static bool valid(const Option& o, std::string_view value) { return !o.check || o.check(value); }
+
+  ///
+  /// @brief Parse the arguments, optionally recording the options found.
+  ///
+  /// @param first, last
+  ///   The range of elements to parse.
+  /// @param result
+  ///   If not null the options found are recorded here.
+  /// @return Returns the first iterator which is not an option.
+  ///
+  args_t::iterator parse(args_t::iterator first, args_t::iterator last, ParseResult* result);
+
+  ///
+  /// @brief Returns true if the outcome of a parse depends only on the
+  ///   arguments and the cache is enabled.
+  ///
+  bool memoizable() const;
+
+  ///
+  /// @brief Builds the cache record of a successful parse.
+  ///
+  /// @param first The first argument.
+  /// @param rest The first argument after the options.
+  /// @param group The selected group.
+  /// @param options The options found.
+  ///
+  memo_t remember(args_t::iterator first, args_t::iterator rest, const Group& group, const occurrences_t& options) const;
+
+  ///
+  /// @brief Restores the options of a cached parse and executes their
+  ///   callbacks.
+  ///
+  /// @param memo The cache record.
+  /// @param first The first argument.
+  /// @param result If not null the options found are recorded here.
+  /// @return The first argument after the options.
+  ///
+  args_t::iterator replay(const memo_t& memo, args_t::iterator first, ParseResult* result);
+
+  ///
+  /// @brief Try each group in sequence until one of them accepts the range
+  ///   of arguments.
+  ///
+  /// @details
+  ///   The options of the selected group are scanned and then the function
+  ///   `finish` is called with the range of remaining arguments, the selected
+  ///   group, and the options found.  The option callbacks are executed after
+  ///   `finish` returns and the value returned by `finish` is returned to the
+  ///   caller.
+  ///
+  /// @param first, last
+  ///   The range of elements to parse.
+  /// @param finish
+  ///   Function checking the arguments after the options.
+  ///
+  /// @return The value returned by `finish`.
+  ///
+  template<typename F>
+  std::invoke_result_t<F, args_t::iterator, args_t::iterator, Group&, occurrences_t&> select(
+    args_t::iterator first, args_t::iterator last, F finish);
+
+  ///
+  /// @brief Add the current group to the list of groups unless it was added
+  ///   by an earlier parse and hasn't changed since.
+  ///
+  void seal();
+
+  ///
+  /// @brief Called by the methods changing the current group.  The group is
+  ///   added to the list of groups again by the next parse and the cache is
+  ///   cleared.
+  ///
+  void changed();
+
+  ///
+  /// @brief Record the outcome of a group in explain mode.
+  ///
+  /// @param group The index of the group.
+  /// @param code The reason the group was rejected, or `error_code::none`.
+  /// @param token The index of the argument causing the rejection.
+  /// @param message The error message.
+  ///
+  void decide(std::size_t group, error_code code, std::size_t token, std::string_view message)
+  {
+    if(_explain)
+      _decisions.push_back({group, code, token, std::string(message)});
+  }
+
+  ///
+  /// @brief Checks the number and lengths of the arguments against the
+  ///   limits.
+  ///
+  /// @param first, last
+  ///   The range of elements to check.
+  ///
+  /// @return The error of the first limit exceeded, if any.
+  ///
+  std::optional<argument_error> exceeded(args_t::iterator first, args_t::iterator last) const;
+
+  ///
+  /// @brief Returns true if an option value exceeds the length limit.
+  ///
+  bool exceeded(std::string_view value) const noexcept { return value.size() > _limits.value_length; }
+
+  ///
+  /// @brief Returns the part of an argument, environment entry, or
+  ///   configuration file line before the value, to name the source of a
+  ///   value in error messages without repeating the value.
+  ///
+  static std::string_view stem(std::string_view source) noexcept
+  {
+    source = source.substr(0, source.find('='));
+    while(!source.empty() && source.back() == ' ')
+      source.remove_suffix(1);
+    return source;
+  }
+
+  ///
+  /// @brief Scan the range of arguments against the option group.
   ///
   /// @param first, last
   ///   The range of elements to parse.
   /// @param group
   ///   Group of options to consider.
+  /// @param options
+  ///   The list of options given on the command line is collected here.
+  /// @param present
+  ///   The constraint bits of the options given are recorded here.
   /// @throws Throws an 'argument_error' exception if there is anything wrong
   ///   such as illegal option, missing option parameter.
   ///
-  /// @return The remaning unprocessed arguments.
+  /// @return The first argument which is not an option.
+  ///
+  args_t::iterator scan(
+    args_t::iterator first, args_t::iterator last, Group& group, occurrences_t& options, presence_t& present);
+
+  ///
+  /// @brief Returns true if the value of an environment variable or a
+  ///   configuration file entry means that an option without a value is
+  ///   given.
+  ///
+  /// @param value The value.
+  /// @return False if the value is empty, "0", or "false".
+  ///
+  static bool given(std::string_view value) noexcept { return !value.empty() && value != "0" && value != "false"; }
+
+  ///
+  /// @brief Scans the environment once for the variables registered with
+  ///   `env` in any group.
+  ///
+  /// @return The entries of the variables which are set.  Empty if no
+  ///   option falls back to an environment variable.
+  ///
+  environment_t resolve_environment() const;
+
+  ///
+  /// @brief Look up the environment variables of the options in a group.
+  ///
+  /// @details
+  ///   Each entry of the resolved environment is looked up in the hash table
+  ///   of the group.
+  ///
+  /// @param group
+  ///   The group.
+  /// @param variables
+  ///   The resolved environment.
+  /// @param f
+  ///   Called with the option, the value, and the whole environment entry
+  ///   for each option whose variable is set.  The values refer to the
+  ///   environment.
+  ///
+  template<typename F>
+  static void environment(const Group& group, const environment_t& variables, F f);
+
+  /// @brief Configuration files in order of increasing precedence.
+  using config_files_t = std::vector<std::shared_ptr<const ConfigFile>>;
+
+  ///
+  /// @brief Load the configuration files which exist.
+  ///
+  config_files_t load_config() const;
+
+  ///
+  /// @brief Look up the entries of the configuration files in a group.
+  ///
+  /// @details
+  ///   The files are visited in order of decreasing precedence and the
+  ///   entries of each file from last to first, so the first call for an
+  ///   option is the one which should take effect.  The key of an entry is
+  ///   the option name without the leading double hyphen.
+  ///
+  /// @param group
+  ///   The group.
+  /// @param files
+  ///   The configuration files.
+  /// @param f
+  ///   Called with the option, the value, and the line of each entry naming
+  ///   an option in the group.  The values refer to the mapped files.
+  ///
+  template<typename G, typename F>
+  static void configuration(G& group, const config_files_t& files, F f);
+
+  ///
+  /// @brief Returns the constraint bit of an option in the current group,
+  ///   assigning the next free bit if the option doesn't have one yet.
+  ///
+  /// @param name The name of the option.
+  ///
+  std::uint64_t constraint_bit(const std::string& name);
+
+  ///
+  /// @brief Add a constraint to the current group.
+  ///
+  /// @param kind The kind of constraint.
+  /// @param trigger The option triggering an `implies` constraint.
+  /// @param names The options of the constraint.
+  ///
+  Program& constrain(constraint_t::kind_t kind, std::uint64_t trigger, const std::vector<std::string>& names);
+
+  ///
+  /// @brief Returns the first constraint of a group violated by a set of
+  ///   options, or null if all constraints are satisfied.
+  ///
+  /// @param group The group.
+  /// @param present The constraint bits of the options given.
   ///
-  args_t::iterator parse(args_t::iterator first, args_t::iterator last, Group& group)
+  static const constraint_t* violated(const Group& group, std::uint64_t present) noexcept
   {
-    std::vector<Option*> options;
-    Option* current_option = nullptr;
-    for(;first != last; ++first)
+    for(auto& c: group.constraints)
     {
-      if(current_option)
-      {
-        // Set the option value
-        current_option->value = *first;
-        current_option->set = true;
-        options.push_back(current_option);
-        current_option = nullptr;
-      }
-      else if(auto opt = find_option(*first, group); opt)
+      auto given = present & c.options;
+      switch(c.kind)
       {
-        // Previous option taking an argument didn't get the argument
-        if(current_option)
-          throw argument_error("missing option value: " + current_option->name());
-        // If the option takes an argument, set current_option
-        if(opt->first->second.argument())
-        {
-          if(opt->second)
-          {
-            opt->first->second.set = true;
-            opt->first->second.value = *opt->second;
-            options.push_back(&opt->first->second);
-          }
-          else
-            current_option = &opt->first->second;
-        }
-        else if(opt->second)
-          throw argument_error("illegal option value: " + *first + "=" + *opt->second);
-        else
-        {
-          options.push_back(&opt->first->second);
-          opt->first->second.set = true;
-        }
+        case constraint_t::exclusive:
+          if((given & (given - 1)) != 0)
+            return &c;
+          break;
+        case constraint_t::implies:
+          if((present & c.trigger) != 0 && given != c.options)
+            return &c;
+          break;
+        case constraint_t::at_least_one:
+          if(given == 0)
+            return &c;
+          break;
       }
-      else if(*first == "--")
-        return exec(++first, last, group, options);
-      else if(!first->empty() && first->at(0) == '-')
-        throw argument_error("unknown option: " + *first);
-      else
-        return exec(first, last, group, options);
     }
-    for(auto& o: group.valid_options)
-      if(o.second.required && !o.second.set)
-        throw argument_error("missing required argument: " + o.second.name());
-    // Last option taking an argument didn't get the argument
-    if(current_option)
-      throw argument_error("missing option value: " + current_option->name());
-    return exec(first, last, group, options);
+    return nullptr;
   }
 
   ///
-  /// @brief Executes the functions associated with the option if all critera
-  /// are met.
+  /// @brief Builds the error message of a violated constraint.
+  ///
+  /// @param group The group.
+  /// @param c The constraint.
+  /// @param present The constraint bits of the options given.
+  ///
+  static std::string message(const Group& group, const constraint_t& c, std::uint64_t present);
+
+  /// @brief Start of the error message for an ambiguous abbreviation.
+  static constexpr const char* ambiguous_option = "ambiguous option: ";
+  /// @brief Start of the error message for an unknown option.
+  static constexpr const char* unknown_option = "unknown option: ";
+  /// @brief Start of the error message for an option value exceeding the
+  ///   length limit.
+  static constexpr const char* value_too_long = "option value too long: ";
+
+  ///
+  /// @brief The result of validating the options of one group.
   ///
   /// @details
-  ///   Verifies that the number of arguments in the range satisfies the group
-  ///   criteria for min and max number of arguments.  If within range each
-  ///   option is processed, meaning the callback function associated with each
-  ///   option is called.  Finally, the first iterator to the first non-option
-  ///   argument is returned to the caller.
+  ///   The reason is null if the options are valid.  Otherwise it's the
+  ///   start of the error message and the token is the rest of the message.
+  ///   Both refer to static or argument storage so that the outcome of each
+  ///   group can be recorded without allocating memory.  The messages of
+  ///   ambiguous and unknown options are completed from the group when
+  ///   they are formatted.
+  ///
+  struct validation_t
+  {
+    const char* reason = nullptr;
+    std::string_view token{};
+  };
+
+  ///
+  /// @brief Scan the range of arguments against the option group without
+  ///   changing any state.
+  ///
+  /// @details
+  ///   Performs the same checks, in the same order, as `scan`.  The options
+  ///   seen are recorded in an `id_set`.
   ///
   /// @param first, last
-  ///   The range of arguments.
+  ///   The range of elements to validate.
   /// @param group
-  ///   The group being processed.
-  /// @param options
-  ///   The list of options given on the command line with any option values.
+  ///   Group of options to consider.
+  /// @param files
+  ///   The configuration files.
+  /// @param variables
+  ///   The resolved environment.
+  /// @param rest
+  ///   Set to the first argument which is not an option on success.
+  /// @param present
+  ///   The constraint bits of the options seen are added here.
+  ///
+  /// @return The outcome of the validation.
+  ///
+  validation_t validate(args_t::iterator first, args_t::iterator last, const Group& group,
+    const config_files_t& files, const environment_t& variables, args_t::iterator& rest,
+    std::uint64_t& present) const;
+
+  ///
+  /// @brief Returns true if a number of arguments satisfies the group
+  ///   criteria for min and max number of arguments.
   ///
-  /// @return The remaining list of arguments.
+  /// @param distance
+  ///   The number of arguments.
+  /// @param group
+  ///   The group being processed.
   ///
-  args_t::iterator exec(args_t::iterator first, args_t::iterator last, Group& group, std::vector<Option*>& options)
+  static bool check_args(std::ptrdiff_t distance, const Group& group)
   {
-    auto distance = std::distance(first, last);
     if(group.min_args)
-    {
-      auto min_args = *group.min_args;
-      if(distance < min_args)
-        usage();
-      if(group.max_args)
-      {
-        auto max_args = *group.max_args;
-        if(distance > max_args)
-          usage();
-      }
-    }
-    else if(distance > 0)
-      usage();
-    for(const auto* o: options)
-      o->exec();
-    return first;
+      return distance >= *group.min_args && (!group.max_args || distance <= *group.max_args);
+    return distance == 0;
   }
+
+  ///
+  /// @brief Verifies that the number of arguments in the range satisfies the
+  ///   group criteria for min and max number of arguments.
+  ///
+  /// @param first, last
+  ///   The range of arguments.
+  /// @param group
+  ///   The group being processed.
+  ///
+  void check_args(args_t::iterator first, args_t::iterator last, Group& group)
+  {
+    if(!check_args(std::distance(first, last), group))
+      usage();
+  }
+
+  ///
+  /// @brief Set the value of an option and execute its callback.
+  ///
+  /// @param o The option.
+  /// @param value The value of the option.
+  ///
+  void run(Option& o, std::string_view value);
+
+  ///
+  /// @brief Executes the functions associated with the options.
+  ///
+  /// @details
+  ///   Without dependencies and concurrency the callbacks are executed in
+  ///   command line order.  Otherwise they are executed in stages as
+  ///   described in `concurrency`.  The value of an option is set just before
+  ///   its callback is executed so an option given more than once sees each
+  ///   of its values in turn.
+  ///
+  /// @param options
+  ///   The list of options given on the command line with any option values.
+  ///
+  void exec(occurrences_t& options);
+};
+
+#if KURI_OPTION_DEFINITIONS
+// In the compiled library these are only defined in compiled.cc.
+
+///
+/// @brief The state of a program whose types are only needed by the
+///   definitions.
+///
+struct Program::state_t
+{
+  /// @brief Counters of the current parse.
+  Instrumentation::counters_t counters;
+  /// @brief Recently parsed command lines.
+  ParseCache<memo_t> cache;
+  /// @brief The environment resolved by the current parse.
+  environment_t environment;
+};
+
+class Program::report_t
+{
+public:
+  explicit report_t(Program& program): _program(program)
+  {
+    if constexpr(instrumented)
+    {
+      _program._state->counters = {};
+      _start = Instrumentation::clock::now();
+    }
+  }
+  ~report_t()
+  {
+    if constexpr(instrumented)
+      if(_program._instrumentation != nullptr)
+        _program._instrumentation->parse(_program._state->counters, _start, Instrumentation::clock::now());
+  }
+  report_t(const report_t&) = delete;
+  report_t& operator=(const report_t&) = delete;
+
+private:
+  Program& _program;
+  Instrumentation::clock::time_point _start;
 };
 
+KURI_OPTION_INLINE Program::Program(std::optional<std::string> program_name, std::shared_ptr<StringPool> names)
+  : _names(names ? std::move(names) : std::make_shared<StringPool>()),
+    _program_name(program_name),
+    _state(std::make_unique<state_t>())
+{}
+
+KURI_OPTION_INLINE Program::~Program() = default;
+
+KURI_OPTION_INLINE Program::Program(Program&&) = default;
+
+KURI_OPTION_INLINE Program& Program::operator=(Program&&) = default;
+
+KURI_OPTION_INLINE Program& Program::options(const OptionSpec* first, const OptionSpec* last)
+{
+  std::vector<std::string_view> keys;
+  keys.reserve(static_cast<std::size_t>(last - first));
+  for(auto* spec = first; spec != last; ++spec)
+    keys.push_back(_names->intern(spec->name));
+  std::vector<std::size_t> sorted(keys.size());
+  for(std::size_t i = 0; i < sorted.size(); ++i)
+    sorted[i] = i;
+  std::sort(sorted.begin(), sorted.end(), [&keys](auto a, auto b) { return keys[a] < keys[b]; });
+  for(std::size_t i = 0; i < sorted.size(); ++i)
+    if((i > 0 && keys[sorted[i]] == keys[sorted[i - 1]]) || _group.valid_options.count(keys[sorted[i]]) > 0)
+      throw std::runtime_error("Program::options: duplicate option: " + std::string(keys[sorted[i]]));
+  for(auto key: keys)
+    _ids.emplace(key, _ids.size());
+  auto hint = _group.valid_options.end();
+  for(auto i: sorted)
+  {
+    auto& spec = first[i];
+    auto o = spec.argument ? Option(keys[i], spec.required, [](const Option&) {})
+                           : Option(keys[i], spec.required, []() {});
+    o.id = _ids.find(keys[i])->second;
+    hint = std::next(_group.valid_options.emplace_hint(hint, keys[i], std::move(o)));
+  }
+  changed();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::depends(const std::string& name, const std::vector<std::string>& dependencies)
+{
+  auto o = _group.valid_options.find(name);
+  if(o == _group.valid_options.end())
+    throw std::runtime_error("Program::depends: unknown option: " + name);
+  std::vector<option_id> ids;
+  ids.reserve(dependencies.size());
+  for(const auto& d: dependencies)
+  {
+    auto dependency = _group.valid_options.find(d);
+    if(dependency == _group.valid_options.end())
+      throw std::runtime_error("Program::depends: unknown option: " + d);
+    ids.push_back(dependency->second.id);
+  }
+  o->second.dependencies = std::move(ids);
+  changed();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::env(const std::string& name, const std::string& variable)
+{
+  auto o = _group.valid_options.find(name);
+  if(o == _group.valid_options.end())
+    throw std::runtime_error("Program::env: unknown option: " + name);
+  _group.environment.insert_or_assign(_names->intern(variable), &o->second);
+  _environment = true;
+  changed();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::config(std::string path)
+{
+  _config.push_back(std::move(path));
+  _state->cache.clear();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::check(const std::string& name, std::function<bool(std::string_view)> predicate)
+{
+  auto o = _group.valid_options.find(name);
+  if(o == _group.valid_options.end() || !o->second.argument())
+    throw std::runtime_error("Program::check: unknown option or option without value: " + name);
+  o->second.check = std::move(predicate);
+  changed();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::abbreviations(bool enable)
+{
+  _abbreviations = enable;
+  _state->cache.clear();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::cache(std::size_t capacity, std::size_t line_bytes)
+{
+  _state->cache.clear();
+  _state->cache.capacity(capacity);
+  _state->cache.line_bytes(line_bytes);
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::limits(const limits_t& limits)
+{
+  _limits = limits;
+  _state->cache.clear();
+  return *this;
+}
+
+KURI_OPTION_INLINE Program& Program::group()
+{
+  _groups.push_back(std::move(_group));
+  _group = Group();
+  changed();
+  return *this;
+}
+
+KURI_OPTION_INLINE ArgStream Program::stream(args_t::iterator first, args_t::iterator last)
+{
+  return select(first, last, [this](args_t::iterator first, args_t::iterator last, Group& group, occurrences_t&) {
+    return ArgStream(first, last, group.min_args, group.max_args, [this]() { usage(); });
+  });
+}
+
+KURI_OPTION_INLINE ArgStream Program::stream(
+  args_t::iterator first, args_t::iterator last, std::istream& is, char delim)
+{
+  return select(first, last,
+    [this, &is, delim](args_t::iterator first, args_t::iterator last, Group& group, occurrences_t&) {
+    return ArgStream(first, last, is, delim, group.min_args, group.max_args, [this]() { usage(); });
+  });
+}
+
+KURI_OPTION_INLINE args_t::iterator Program::parse(args_t::iterator first, args_t::iterator last, ParseResult* result)
+{
+  Group* selected = nullptr;
+  args_t::iterator rest;
+  bool memoize = memoizable();
+  if(const auto* memo = memoize ? _state->cache.find(first, last) : nullptr; memo != nullptr)
+  {
+    selected = &_groups[memo->group];
+    rest = replay(*memo, first, result);
+  }
+  else
+  {
+    memo_t record;
+    const auto start = first;
+    rest = select(first, last,
+      [&](args_t::iterator first, args_t::iterator last, Group& group, occurrences_t& options) {
+        check_args(first, last, group);
+        selected = &group;
+        if(result != nullptr)
+        {
+          result->reset(_ids.size());
+          for(auto& [o, value]: options)
+            result->set(o->id, value);
+        }
+        if(memoize)
+          record = remember(start, first, group, options);
+        return first;
+      });
+    if(memoize)
+      _state->cache.insert(start, last, std::move(record));
+  }
+  if(result != nullptr)
+    result->finish(static_cast<std::size_t>(selected - _groups.data()), rest, last);
+  if(selected->handler)
+    parallel_for(static_cast<std::size_t>(std::distance(rest, last)), selected->concurrency,
+      [&](std::size_t i) { selected->handler(*(rest + i)); });
+  return rest;
+}
+
+KURI_OPTION_INLINE bool Program::memoizable() const
+{
+  return _state->cache.capacity() > 0 && !_explain && _config.empty() && !_environment;
+}
+
+KURI_OPTION_INLINE void Program::seal()
+{
+  if(_added)
+    return;
+  _groups.push_back(std::move(_group));
+  _group = Group();
+  _added = true;
+}
+
+KURI_OPTION_INLINE void Program::changed()
+{
+  _added = false;
+  _state->cache.clear();
+}
+
+KURI_OPTION_INLINE std::optional<std::pair<Option*, std::optional<std::string_view>>> Program::lookup(
+  std::string_view arg, Group& group)
+{
+  if constexpr(instrumented)
+    ++_state->counters.lookups;
+  return find_option(arg, group);
+}
+
+KURI_OPTION_INLINE void Program::run(Option& o, std::string_view value)
+{
+  o.value = value;
+  if constexpr(instrumented)
+    if(_instrumentation != nullptr)
+    {
+      auto start = Instrumentation::clock::now();
+      o.exec();
+      _instrumentation->callback(o.name(), start, Instrumentation::clock::now());
+      return;
+    }
+  o.exec();
+}
+
+KURI_OPTION_INLINE std::uint64_t Program::constraint_bit(const std::string& name)
+{
+  auto o = _group.valid_options.find(name);
+  if(o == _group.valid_options.end())
+    throw std::runtime_error("Program: unknown option in constraint: " + name);
+  if(o->second.constraint_bit == 0)
+  {
+    if(_group.constrained.size() == 64)
+      throw std::runtime_error("Program: too many options in constraints: " + name);
+    o->second.constraint_bit = std::uint64_t(1) << _group.constrained.size();
+    _group.constrained.push_back(o->first);
+  }
+  return o->second.constraint_bit;
+}
+
+KURI_OPTION_INLINE Program& Program::constrain(
+  constraint_t::kind_t kind, std::uint64_t trigger, const std::vector<std::string>& names)
+{
+  constraint_t c{kind, trigger};
+  for(auto& name: names)
+    c.options |= constraint_bit(name);
+  _group.constraints.push_back(c);
+  changed();
+  return *this;
+}
+
+KURI_OPTION_INLINE const cache_stats_t& Program::cache_stats() const noexcept
+{
+  return _state->cache.stats();
+}
+
+template<typename F>
+std::invoke_result_t<F, args_t::iterator, args_t::iterator, Program::Group&, Program::occurrences_t&> Program::select(
+  args_t::iterator first, args_t::iterator last, F finish)
+{
+  if(auto error = exceeded(first, last); error)
+    throw *error;
+  seal();
+  _config_files = load_config();
+  _state->environment = resolve_environment();
+  report_t report(*this);
+  _decisions.clear();
+  _errors.clear();
+  for(std::size_t index = 0; index < _groups.size(); ++index)
+  {
+    auto& group = _groups[index];
+    if constexpr(instrumented)
+      ++_state->counters.groups;
+    try
+    {
+      occurrences_t options;
+      presence_t present;
+      auto rest = scan(first, last, group, options, present);
+      if(auto* c = violated(group, present.bits); c != nullptr)
+        throw argument_error(error_code::constraint, message(group, *c, present.bits), present.token(*c));
+      auto token = static_cast<std::size_t>(std::distance(first, rest));
+      auto result = [&]() {
+        try
+        {
+          return finish(rest, last, group, options);
+        }
+        catch(const usage_error& e)
+        {
+          decide(index, error_code::argument_count, token, e.what());
+          throw;
+        }
+      }();
+      decide(index, error_code::none, token, {});
+      exec(options);
+      return result;
+    }
+    catch(const argument_error& e)
+    {
+      if constexpr(instrumented)
+        ++_state->counters.errors;
+      if(e.code() == error_code::limit_exceeded)
+        throw;
+      _errors.push_back(e.what());
+      decide(index, e.code(), e.token(), e.what());
+    }
+  }
+  usage();
+  throw;
+}
+
+template<typename F>
+void Program::environment(const Group& group, const environment_t& variables, F f)
+{
+  if(group.environment.empty())
+    return;
+  for(auto entry: variables)
+  {
+    auto pos = entry.find('=');
+    if(auto v = group.environment.find(entry.substr(0, pos)); v != group.environment.end())
+      f(v->second, entry.substr(pos + 1), entry);
+  }
+}
+
+template<typename G, typename F>
+void Program::configuration(G& group, const config_files_t& files, F f)
+{
+  char name[128] = {'-', '-'};
+  for(auto file = files.rbegin(); file != files.rend(); ++file)
+    for(auto e = (*file)->entries().rbegin(); e != (*file)->entries().rend(); ++e)
+    {
+      if(e->key.size() > sizeof(name) - 2)
+        continue;
+      std::copy(e->key.begin(), e->key.end(), name + 2);
+      if(auto o = group.valid_options.find(std::string_view(name, e->key.size() + 2)); o != group.valid_options.end())
+        f(&o->second, e->value, e->line);
+    }
+}
+
+KURI_OPTION_INLINE std::string Program::explanation(args_t::iterator first, args_t::iterator last) const
+{
+  std::string result;
+  auto size = static_cast<std::size_t>(std::distance(first, last));
+  for(auto& d: _decisions)
+  {
+    result += "group " + std::to_string(d.group) + ": ";
+    if(d.code == error_code::none)
+      result += "selected";
+    else
+    {
+      result += "rejected";
+      if(d.token != argument_error::no_token)
+      {
+        result += " at argument " + std::to_string(d.token);
+        if(d.token < size)
+          result += " '" + *(first + static_cast<std::ptrdiff_t>(d.token)) + "'";
+      }
+      result += ": " + d.message;
+    }
+    result += '\n';
+  }
+  return result;
+}
+
+KURI_OPTION_INLINE std::optional<std::string> Program::validate(args_t::iterator first, args_t::iterator last) const
+{
+  if(auto limit = exceeded(first, last); limit)
+    return limit->what();
+  config_files_t files;
+  if(!_config.empty())
+    files = load_config();
+  auto variables = resolve_environment();
+  // The first failure is only formatted if no group is selected so that
+  // trying the groups before the selected one doesn't allocate.
+  const Group* failed = nullptr;
+  validation_t failure;
+  const constraint_t* conflict = nullptr;
+  std::uint64_t conflict_present = 0;
+  auto error = [&]() -> std::string {
+    if(conflict != nullptr)
+      return message(*failed, *conflict, conflict_present);
+    if(failure.reason == ambiguous_option)
+      return ambiguity(failure.token, *failed);
+    if(failure.reason == unknown_option)
+      return unknown_option + std::string(failure.token) + did_you_mean(suggest(failure.token, *failed));
+    return failure.reason + std::string(failure.token);
+  };
+  std::optional<std::string> result;
+  auto check = [&](const Group& group) {
+    args_t::iterator rest;
+    std::uint64_t present = 0;
+    auto invalid = validate(first, last, group, files, variables, rest, present);
+    if(invalid.reason == value_too_long)
+    {
+      result = invalid.reason + std::string(invalid.token);
+      return true;
+    }
+    if(invalid.reason != nullptr)
+    {
+      if(failed == nullptr)
+      {
+        failed = &group;
+        failure = invalid;
+      }
+      return false;
+    }
+    if(auto* c = violated(group, present); c != nullptr)
+    {
+      if(failed == nullptr)
+      {
+        failed = &group;
+        conflict = c;
+        conflict_present = present;
+      }
+      return false;
+    }
+    if(!check_args(std::distance(rest, last), group))
+      result = failed != nullptr ? error() : "wrong number of arguments";
+    return true;
+  };
+  for(auto& group: _groups)
+    if(check(group))
+      return result;
+  if(!check(_group))
+    return error();
+  return result;
+}
+
+KURI_OPTION_INLINE std::vector<std::string> Program::complete(args_t::iterator first, args_t::iterator last) const
+{
+  std::vector<std::string> candidates;
+  std::string_view word = first == last ? std::string_view() : std::string_view(*--last);
+  std::vector<const Group*> groups;
+  for(auto& g: _groups)
+    groups.push_back(&g);
+  groups.push_back(&_group);
+  bool value = false;
+  for(; first != last; ++first)
+  {
+    if(value)
+    {
+      value = false;
+      continue;
+    }
+    if(*first == "--" || first->empty() || first->front() != '-')
+      return candidates;
+    for(const auto* g: groups)
+      if(auto o = g->valid_options.find(*first); o != g->valid_options.end())
+      {
+        value = o->second.argument();
+        break;
+      }
+  }
+  if(value || (!word.empty() && word.front() != '-'))
+    return candidates;
+  for(const auto* g: groups)
+    for(auto o = g->valid_options.lower_bound(word); o != g->valid_options.end() && starts_with(o->first, word); ++o)
+      candidates.emplace_back(o->first);
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  return candidates;
+}
+
+KURI_OPTION_INLINE std::vector<std::string> Program::help()
+{
+  std::vector<std::string> help_strings;
+  for(auto& g: _groups)
+    help_strings.push_back(help(g));
+  return help_strings;
+}
+
+KURI_OPTION_INLINE void Program::usage()
+{
+  if(_errors.empty())
+    option::usage(help());
+  option::usage(Error(_errors), help());
+}
+
+KURI_OPTION_INLINE std::string Program::help(const Group& g) const
+{
+  std::string help;
+  bool first = true;
+  if(_program_name)
+  {
+    first = false;
+    help = *_program_name;
+  }
+  for(auto& [key, o]: g.valid_options)
+  {
+    if(first)
+      first = false;
+    else
+      help += " ";
+    help += o.help();
+  }
+  if(g.min_args)
+  {
+    auto min_args = *g.min_args;
+    for(auto i = 1; i <= min_args; ++i)
+      help += " <arg>";
+    if(g.max_args)
+    {
+      if(*g.max_args > min_args)
+      {
+        help += " [";
+        int first = 0;
+        for(auto i = *g.min_args; i < *g.max_args; ++i)
+        {
+          if(first > 0)
+            help += " [";
+          ++first;
+          help += "<arg>";
+        }
+        help += std::string(first, ']');
+      }
+    }
+    else
+      help += " [<arg>...]";
+  }
+  return help;
+}
+
+KURI_OPTION_INLINE std::optional<std::pair<const Option*, std::optional<std::string_view>>> Program::find_option(
+  std::string_view arg, const Group& group) const
+{
+  auto opt = group.valid_options.find(arg);
+  if(opt != group.valid_options.end())
+    return std::make_pair(&opt->second, std::optional<std::string_view>());
+  auto pos = arg.find_first_of('=');
+  std::optional<std::string_view> value;
+  if(pos != std::string_view::npos)
+  {
+    value = arg.substr(pos + 1);
+    opt = group.valid_options.find(arg.substr(0, pos));
+    if(opt != group.valid_options.end())
+      return std::make_pair(&opt->second, value);
+  }
+  if(_abbreviations)
+  {
+    auto [first, last] = abbreviated(arg.substr(0, pos), group);
+    if(first != last && std::next(first) == last)
+      return std::make_pair(&first->second, value);
+  }
+  return {};
+}
+
+KURI_OPTION_INLINE std::pair<Program::Group::valid_options_t::const_iterator,
+  Program::Group::valid_options_t::const_iterator>
+Program::abbreviated(std::string_view name, const Group& group, bool all)
+{
+  auto first = group.valid_options.end();
+  if(name.size() <= 2 || !starts_with(name, "--"))
+    return {first, first};
+  first = group.valid_options.lower_bound(name);
+  auto last = first;
+  for(int n = 0; last != group.valid_options.end() && starts_with(last->first, name) && (all || n < 2); ++n)
+    ++last;
+  return {first, last};
+}
+
+KURI_OPTION_INLINE bool Program::ambiguous(std::string_view arg, const Group& group) const
+{
+  if(!_abbreviations)
+    return false;
+  auto [first, last] = abbreviated(arg.substr(0, arg.find('=')), group);
+  return first != last && std::next(first) != last;
+}
+
+KURI_OPTION_INLINE std::string Program::ambiguity(std::string_view arg, const Group& group) const
+{
+  if(!_abbreviations)
+    return {};
+  auto [first, last] = abbreviated(arg.substr(0, arg.find('=')), group, true);
+  if(first == last || std::next(first) == last)
+    return {};
+  std::string message = ambiguous_option + std::string(arg) + " (";
+  for(auto o = first; o != last; ++o)
+    message += (o == first ? "" : " ") + std::string(o->first);
+  return message + ")";
+}
+
+KURI_OPTION_INLINE std::string_view Program::suggest(std::string_view arg, const Group& group)
+{
+  Nearest nearest(arg.substr(0, arg.find('=')));
+  for(auto& [key, o]: group.valid_options)
+    nearest(key);
+  return nearest.best();
+}
+
+KURI_OPTION_INLINE args_t::iterator Program::scan(
+  args_t::iterator first, args_t::iterator last, Group& group, occurrences_t& options, presence_t& present)
+{
+  const auto start = first;
+  auto token = [&start, &first]() { return static_cast<std::size_t>(std::distance(start, first)); };
+  // Presence is tracked per scan since options keep their state between
+  // parses.
+  id_set seen(_ids.size());
+  auto mark = [&seen, &present](Option* o, std::size_t token) {
+    o->set = true;
+    seen.set(o->id);
+    present.mark(o, token);
+  };
+  for(auto& [key, o]: group.valid_options)
+    o.set = false;
+  Option* current_option = nullptr;
+  bool options_end = false;
+  for(;first != last; ++first)
+  {
+    if constexpr(instrumented)
+      ++_state->counters.tokens;
+    if(current_option)
+    {
+      if(exceeded(*first))
+        throw argument_error(error_code::limit_exceeded, value_too_long + std::string(*(first - 1)), token());
+      if(!valid(*current_option, *first))
+        throw argument_error(error_code::invalid_value, "invalid option value: " + *first, token());
+      // Set the option value
+      mark(current_option, token() - 1);
+      options.emplace_back(current_option, *first);
+      current_option = nullptr;
+    }
+    else if(auto opt = lookup(*first, group); opt)
+    {
+      auto* o = opt->first;
+      // If the option takes an argument, set current_option
+      if(o->argument())
+      {
+        if(opt->second)
+        {
+          if(exceeded(*opt->second))
+            throw argument_error(error_code::limit_exceeded, value_too_long + std::string(stem(*first)), token());
+          if(!valid(*o, *opt->second))
+            throw argument_error(error_code::invalid_value, "invalid option value: " + *first, token());
+          mark(o, token());
+          options.emplace_back(o, *opt->second);
+        }
+        else
+          current_option = o;
+      }
+      else if(opt->second)
+        throw argument_error(error_code::illegal_value, "illegal option value: " + *first, token());
+      else
+      {
+        mark(o, token());
+        options.emplace_back(o, std::string_view());
+      }
+    }
+    else if(*first == "--")
+    {
+      ++first;
+      options_end = true;
+      break;
+    }
+    else if(!first->empty() && first->at(0) == '-')
+    {
+      if(auto message = ambiguity(*first, group); !message.empty())
+        throw argument_error(error_code::ambiguous_option, message, token());
+      throw argument_error(
+        error_code::unknown_option, "unknown option: " + *first + did_you_mean(suggest(*first, group)), token());
+    }
+    else
+    {
+      options_end = true;
+      break;
+    }
+  }
+  if(!group.environment.empty() || !_config_files.empty())
+  {
+    id_set decided(_ids.size());
+    auto fallback = [&](Option* o, std::string_view value, std::string_view source) {
+      if(seen.test(o->id) || decided.test(o->id))
+        return;
+      decided.set(o->id);
+      if(!o->argument() && !given(value))
+        return;
+      if(exceeded(value))
+        throw argument_error(error_code::limit_exceeded, value_too_long + std::string(stem(source)));
+      if(!valid(*o, value))
+        throw argument_error(error_code::invalid_value, "invalid option value: " + std::string(source));
+      mark(o, argument_error::no_token);
+      options.emplace_back(o, o->argument() ? value : std::string_view());
+    };
+    environment(group, _state->environment, fallback);
+    configuration(group, _config_files, fallback);
+  }
+  if(options_end)
+    return first;
+  for(auto& o: group.valid_options)
+    if(o.second.required && !seen.test(o.second.id))
+      throw argument_error(error_code::missing_required, "missing required argument: " + o.second.name(), token());
+  // Last option taking an argument didn't get the argument
+  if(current_option)
+    throw argument_error(error_code::missing_value, "missing option value: " + current_option->name(), token() - 1);
+  return first;
+}
+
+KURI_OPTION_INLINE std::optional<argument_error> Program::exceeded(args_t::iterator first, args_t::iterator last) const
+{
+  auto size = static_cast<std::size_t>(std::distance(first, last));
+  if(size > _limits.tokens)
+    return argument_error(error_code::limit_exceeded,
+      "too many arguments: " + std::to_string(size) + " (limit " + std::to_string(_limits.tokens) + ")",
+      _limits.tokens);
+  if(_limits.token_length == std::numeric_limits<std::size_t>::max())
+    return {};
+  for(std::size_t token = 0; first != last; ++first, ++token)
+    if(first->size() > _limits.token_length)
+      return argument_error(error_code::limit_exceeded,
+        "argument too long: " + std::to_string(first->size()) + " characters (limit "
+          + std::to_string(_limits.token_length) + ")",
+        token);
+  return {};
+}
+
+KURI_OPTION_INLINE Program::environment_t Program::resolve_environment() const
+{
+  environment_t variables;
+  if(!_environment)
+    return variables;
+  auto registered = [this](std::string_view name) {
+    if(_group.environment.count(name) > 0)
+      return true;
+    for(auto& group: _groups)
+      if(group.environment.count(name) > 0)
+        return true;
+    return false;
+  };
+  for(char** e = environ; *e != nullptr; ++e)
+  {
+    std::string_view entry(*e);
+    if(auto pos = entry.find('='); pos != std::string_view::npos && registered(entry.substr(0, pos)))
+      variables.push_back(entry);
+  }
+  return variables;
+}
+
+KURI_OPTION_INLINE Program::config_files_t Program::load_config() const
+{
+  config_files_t files;
+  for(auto& path: _config)
+    if(auto file = ConfigFile::load(path); file)
+      files.push_back(std::move(file));
+  return files;
+}
+
+KURI_OPTION_INLINE std::string Program::message(const Group& group, const constraint_t& c, std::uint64_t present)
+{
+  auto names = [&group](std::uint64_t bits) {
+    std::string result;
+    for(std::size_t i = 0; i < group.constrained.size(); ++i)
+      if((bits & (std::uint64_t(1) << i)) != 0)
+        result += (result.empty() ? "" : " ") + std::string(group.constrained[i]);
+    return result;
+  };
+  switch(c.kind)
+  {
+    case constraint_t::exclusive:
+      return "conflicting options: " + names(present & c.options);
+    case constraint_t::implies:
+      return "option " + names(c.trigger) + " requires: " + names(c.options & ~present);
+    case constraint_t::at_least_one:
+      break;
+  }
+  return "missing one of: " + names(c.options);
+}
+
+KURI_OPTION_INLINE Program::validation_t Program::validate(args_t::iterator first, args_t::iterator last,
+  const Group& group, const config_files_t& files, const environment_t& variables, args_t::iterator& rest,
+  std::uint64_t& present) const
+{
+  id_set seen(_ids.size());
+  auto mark = [&seen, &present](const Option* o) {
+    seen.set(o->id);
+    present |= o->constraint_bit;
+  };
+  auto bit = [&seen](const Option* o) { return seen.test(o->id); };
+  const Option* current_option = nullptr;
+  std::string_view current_token;
+  bool options_end = false;
+  for(; first != last; ++first)
+  {
+    if(current_option)
+    {
+      if(exceeded(*first))
+        return {value_too_long, current_token};
+      if(!valid(*current_option, *first))
+        return {"invalid option value: ", *first};
+      mark(current_option);
+      current_option = nullptr;
+    }
+    else if(auto opt = find_option(*first, group); opt)
+    {
+      auto* o = opt->first;
+      if(o->argument())
+      {
+        if(!opt->second)
+        {
+          current_option = o;
+          current_token = *first;
+        }
+        else if(exceeded(*opt->second))
+          return {value_too_long, stem(*first)};
+        else if(!valid(*o, *opt->second))
+          return {"invalid option value: ", *first};
+        else
+          mark(o);
+      }
+      else if(opt->second)
+        return {"illegal option value: ", *first};
+      else
+        mark(o);
+    }
+    else if(*first == "--")
+    {
+      ++first;
+      options_end = true;
+      break;
+    }
+    else if(!first->empty() && first->at(0) == '-')
+    {
+      if(ambiguous(*first, group))
+        return {ambiguous_option, *first};
+      return {unknown_option, *first};
+    }
+    else
+    {
+      options_end = true;
+      break;
+    }
+  }
+  validation_t invalid;
+  if(!group.environment.empty() || !files.empty())
+  {
+    id_set decided(_ids.size());
+    auto fallback = [&](const Option* o, std::string_view value, std::string_view source) {
+      if(bit(o) || decided.test(o->id) || invalid.reason != nullptr)
+        return;
+      decided.set(o->id);
+      if(!o->argument() && !given(value))
+        return;
+      if(exceeded(value))
+        invalid = {value_too_long, stem(source)};
+      else if(!valid(*o, value))
+        invalid = {"invalid option value: ", source};
+      mark(o);
+    };
+    environment(group, variables, fallback);
+    configuration(group, files, fallback);
+  }
+  if(invalid.reason != nullptr)
+    return invalid;
+  rest = first;
+  if(options_end)
+    return {};
+  for(auto& [key, o]: group.valid_options)
+    if(o.required && !bit(&o))
+      return {"missing required argument: ", key};
+  if(current_option)
+    return {"missing option value: ", current_token};
+  return {};
+}
+
+KURI_OPTION_INLINE Program::memo_t Program::remember(
+  args_t::iterator first, args_t::iterator rest, const Group& group, const occurrences_t& options) const
+{
+  memo_t memo;
+  memo.group = static_cast<std::size_t>(&group - _groups.data());
+  memo.rest = static_cast<std::size_t>(std::distance(first, rest));
+  memo.options.reserve(options.size());
+  std::less_equal<const char*> le;
+  for(auto& [o, value]: options)
+  {
+    memo_t::occurrence_t occurrence{o, argument_error::no_token, 0, value.size()};
+    for(auto token = first; token != rest && value.data() != nullptr; ++token)
+      if(le(token->data(), value.data()) && le(value.data(), token->data() + token->size()))
+      {
+        occurrence.token = static_cast<std::size_t>(std::distance(first, token));
+        occurrence.offset = static_cast<std::size_t>(value.data() - token->data());
+        break;
+      }
+    memo.options.push_back(occurrence);
+  }
+  return memo;
+}
+
+KURI_OPTION_INLINE args_t::iterator Program::replay(const memo_t& memo, args_t::iterator first, ParseResult* result)
+{
+  report_t report(*this);
+  _decisions.clear();
+  for(auto& [key, o]: _groups[memo.group].valid_options)
+    o.set = false;
+  occurrences_t options;
+  options.reserve(memo.options.size());
+  for(auto& o: memo.options)
+  {
+    o.option->set = true;
+    std::string_view value;
+    if(o.token != argument_error::no_token)
+      value = std::string_view(*(first + static_cast<std::ptrdiff_t>(o.token))).substr(o.offset, o.length);
+    options.emplace_back(o.option, value);
+  }
+  if(result != nullptr)
+  {
+    result->reset(_ids.size());
+    for(auto& [o, value]: options)
+      result->set(o->id, value);
+  }
+  exec(options);
+  return first + static_cast<std::ptrdiff_t>(memo.rest);
+}
+
+KURI_OPTION_INLINE std::uint64_t Program::fingerprint() const
+{
+  auto hash = fnv1a({});
+  auto add = [&hash](std::uint64_t n) {
+    hash = fnv1a(std::string_view(reinterpret_cast<const char*>(&n), sizeof(n)), hash);
+  };
+  auto group = [&](const Group& g) {
+    add(static_cast<std::uint64_t>(g.min_args.value_or(-1)));
+    add(static_cast<std::uint64_t>(g.max_args.value_or(-1)));
+    add(g.valid_options.size());
+    for(auto& [name, o]: g.valid_options)
+    {
+      add(name.size());
+      hash = fnv1a(name, hash);
+      add(o.id);
+      add((o.argument() ? 2 : 0) | (o.required ? 1 : 0));
+    }
+  };
+  add(_ids.size());
+  for(auto& g: _groups)
+    group(g);
+  if(!_added)
+    group(_group);
+  return hash;
+}
+
+KURI_OPTION_INLINE ParseResult Program::decode(std::string_view blob) const
+{
+  return ParseResult::decode(blob, fingerprint(), _ids.size());
+}
+
+KURI_OPTION_INLINE void Program::replay(const ParseResult& result)
+{
+  if(result.size() != _ids.size())
+    throw std::runtime_error("Program::replay: result of a different program");
+  seal();
+  if(result.group() >= _groups.size())
+    throw std::runtime_error("Program::replay: bad group");
+  auto& group = _groups[result.group()];
+  std::vector<Option*> by_id(_ids.size());
+  for(auto& [key, o]: group.valid_options)
+  {
+    o.set = false;
+    by_id[o.id] = &o;
+  }
+  report_t report(*this);
+  _decisions.clear();
+  occurrences_t options;
+  options.reserve(result.occurrences().size());
+  for(auto& [id, value]: result.occurrences())
+  {
+    auto* o = by_id[id];
+    if(o == nullptr)
+      throw std::runtime_error("Program::replay: option not in the group");
+    o->set = true;
+    options.emplace_back(o, value);
+  }
+  exec(options);
+  if(group.handler)
+  {
+    auto args = result.args();
+    parallel_for(args.size(), group.concurrency, [&](std::size_t i) { group.handler(std::string(args[i])); });
+  }
+}
+
+KURI_OPTION_INLINE void Program::exec(occurrences_t& options)
+{
+  auto ordered = [](const auto& o) { return o.first->dependencies.empty(); };
+  if(_concurrency == 1 && std::all_of(options.begin(), options.end(), ordered))
+  {
+    for(auto& [o, value]: options)
+      run(*o, value);
+    return;
+  }
+  // Each distinct option is executed once for each time it occurs on the
+  // command line.  Options are assigned to stages based on their
+  // dependencies.
+  constexpr auto none = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> index(_ids.size(), none);
+  std::vector<Option*> distinct;
+  std::vector<std::vector<std::string_view>> values;
+  for(auto& [o, value]: options)
+  {
+    auto& i = index[o->id];
+    if(i == none)
+    {
+      i = distinct.size();
+      distinct.push_back(o);
+      values.emplace_back(1, value);
+    }
+    else
+      values[i].push_back(value);
+  }
+  std::vector<int> stage(distinct.size(), -1);
+  std::function<int(std::size_t, std::size_t)> visit = [&](std::size_t i, std::size_t depth) {
+    if(depth > distinct.size())
+      throw std::runtime_error("Program: dependency cycle: " + distinct[i]->name());
+    if(stage[i] < 0)
+    {
+      int s = 0;
+      for(auto d: distinct[i]->dependencies)
+        if(index[d] != none)
+          s = std::max(s, visit(index[d], depth + 1) + 1);
+      stage[i] = s;
+    }
+    return stage[i];
+  };
+  int stages = 0;
+  for(std::size_t i = 0; i < distinct.size(); ++i)
+    stages = std::max(stages, visit(i, 0) + 1);
+  std::vector<std::size_t> tasks;
+  for(int s = 0; s < stages; ++s)
+  {
+    tasks.clear();
+    for(std::size_t i = 0; i < distinct.size(); ++i)
+      if(stage[i] == s)
+        tasks.push_back(i);
+    parallel_for(tasks.size(), _concurrency, [&](std::size_t t) {
+      for(auto value: values[tasks[t]])
+        run(*distinct[tasks[t]], value);
+    });
+  }
+}
+
+#endif
+
 } // namespace kuri::option
@@ -16,12 +16,44 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_session.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
 
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "ConfigFile.hh"
 #include "Program.hh"
+#include "numeric_list.hh"
+#include "suggest.hh"
 
 using namespace kuri::option;
 using namespace std::literals;
 
+namespace
+{
+// The number of memory allocations made by the current thread.
+thread_local std::size_t allocations = 0;
+} // namespace
+
+void* operator new(std::size_t size)
+{
+  ++allocations;
+  if(auto* p = std::malloc(size == 0 ? 1 : size); p != nullptr)
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
 TEST_CASE("One optional boolean option")
 {
   bool test = false;
@@ -78,6 +110,20 @@ TEST_CASE("Leave required option out")
     program.parse(args.begin(), args.end()), "missing required argument: --test\nusage: test --test"s);
 }
 
+TEST_CASE("Leave required option out after a parse with it")
+{
+  Program program("test");
+  program.required("--test", []() {}).optional("--other", []() {});
+  std::vector<std::string> args = {"--test"};
+  program.parse(args.begin(), args.end());
+  args = {"--test", "--bad"};
+  CHECK_THROWS(program.parse(args.begin(), args.end()));
+  args = {"--other"};
+  CHECK(program.validate(args.begin(), args.end()) == "missing required argument: --test");
+  REQUIRE_THROWS_WITH(
+    program.parse(args.begin(), args.end()), "missing required argument: --test\nusage: test [--other] --test"s);
+}
+
 TEST_CASE("Single option taking a value")
 {
   Program program("test");
@@ -168,6 +214,873 @@ TEST_CASE("Help string for arguments")
   CHECK(help[5] == "test [<arg>...]");
 }
 
+TEST_CASE("Stream of arguments")
+{
+  Program program("test");
+  bool test = false;
+  program.optional("--test", [&]() { test = true; }).args(1, 3);
+  SECTION("Arguments from the range")
+  {
+    std::vector<std::string> args = {"--test", "1", "2"};
+    auto stream = program.stream(args.begin(), args.end());
+    CHECK(test);
+    CHECK(stream.next() == "1"sv);
+    CHECK(stream.next() == "2"sv);
+    CHECK(!stream.next());
+    CHECK(stream.count() == 2);
+  }
+  SECTION("Arguments from the range followed by an input stream")
+  {
+    std::vector<std::string> args = {"1"};
+    std::istringstream is("2\0\0003\0"s);
+    auto stream = program.stream(args.begin(), args.end(), is, '\0');
+    CHECK(stream.next() == "1"sv);
+    CHECK(stream.next() == "2"sv);
+    CHECK(stream.next() == "3"sv);
+    CHECK(!stream.next());
+  }
+  SECTION("Too many arguments")
+  {
+    std::vector<std::string> args = {"1", "2", "3"};
+    std::istringstream is("4\n5\n");
+    auto stream = program.stream(args.begin(), args.end(), is);
+    for(auto i = 0; i < 3; ++i)
+      CHECK(stream.next());
+    CHECK_THROWS_AS(stream.next(), usage_error);
+  }
+  SECTION("Too few arguments")
+  {
+    std::vector<std::string> args = {};
+    auto stream = program.stream(args.begin(), args.end());
+    CHECK_THROWS_AS(stream.next(), usage_error);
+  }
+}
+
+TEST_CASE("Argument handler")
+{
+  std::vector<std::string> args;
+  for(auto i = 0; i < 100; ++i)
+    args.push_back(std::to_string(i));
+  SECTION("Sequential handler")
+  {
+    std::vector<std::string> seen;
+    Program program("test");
+    program.args(0, {}, [&](const std::string& arg) { seen.push_back(arg); });
+    auto result = program.parse(args.begin(), args.end());
+    CHECK(result == args.begin());
+    CHECK(seen == args);
+  }
+  SECTION("Concurrent handler")
+  {
+    std::mutex mutex;
+    std::set<std::string> seen;
+    Program program("test");
+    program.args(0, {}, [&](const std::string& arg) {
+      std::lock_guard lock(mutex);
+      seen.insert(arg);
+    }, 4);
+    program.parse(args.begin(), args.end());
+    CHECK(seen.size() == args.size());
+  }
+  SECTION("First failing argument is reported")
+  {
+    std::atomic<int> calls = 0;
+    Program program("test");
+    program.args(0, {}, [&](const std::string& arg) {
+      ++calls;
+      auto i = std::stoi(arg);
+      if(i == 10 || i == 20)
+        throw std::runtime_error(arg);
+    }, 4);
+    REQUIRE_THROWS_WITH(program.parse(args.begin(), args.end()), "10");
+    CHECK(calls < 100);
+  }
+}
+
+TEST_CASE("Option callback dependencies")
+{
+  std::mutex mutex;
+  std::vector<std::string> order;
+  auto record = [&](const std::string& name) {
+    return [&, name]() {
+      std::lock_guard lock(mutex);
+      order.push_back(name);
+    };
+  };
+  Program program("test");
+  program.optional("--config", record("config"))
+    .optional("--db", record("db"))
+    .optional("--model", record("model"))
+    .optional("--cache", record("cache"))
+    .depends("--db", {"--config"})
+    .depends("--model", {"--config", "--cache"});
+  SECTION("Sequential")
+  {
+    std::vector<std::string> args = {"--model", "--db", "--config"};
+    program.parse(args.begin(), args.end());
+    CHECK(order == std::vector<std::string>{"config", "model", "db"});
+  }
+  SECTION("Concurrent")
+  {
+    program.concurrency(4);
+    std::vector<std::string> args = {"--model", "--db", "--cache", "--config"};
+    program.parse(args.begin(), args.end());
+    REQUIRE(order.size() == 4);
+    auto position = [&](const std::string& name) { return std::find(order.begin(), order.end(), name); };
+    CHECK(position("config") < position("db"));
+    CHECK(position("config") < position("model"));
+    CHECK(position("cache") < position("model"));
+  }
+  SECTION("Unknown option")
+  {
+    CHECK_THROWS(program.depends("--unknown", {"--config"}));
+    CHECK_THROWS_WITH(program.depends("--db", {"--unknown"}), "Program::depends: unknown option: --unknown");
+  }
+}
+
+TEST_CASE("Option callback dependency cycle")
+{
+  Program program("test");
+  program.optional("--a", []() {}).optional("--b", []() {}).depends("--a", {"--b"}).depends("--b", {"--a"});
+  std::vector<std::string> args = {"--a", "--b"};
+  CHECK_THROWS_WITH(program.parse(args.begin(), args.end()), Catch::Matchers::ContainsSubstring("dependency cycle"));
+}
+
+TEST_CASE("Parse result")
+{
+  Program program("test");
+  program.optional("--verbose", []() {})
+    .optional("--threads", [](const Option&) {})
+    .optional("--name", [](const Option&) {})
+    .group()
+    .optional("--verbose", []() {})
+    .required("--other", []() {});
+  CHECK(program.id("--verbose") == 0);
+  CHECK(program.id("--threads") == 1);
+  CHECK(program.id("--name") == 2);
+  CHECK(program.id("--other") == 3);
+  CHECK_THROWS(program.id("--unknown"));
+  std::vector<std::string> args = {"--verbose", "--threads", "4", "--name=x"};
+  ParseResult result;
+  program.parse(args.begin(), args.end(), result);
+  CHECK(result.size() == 4);
+  CHECK(result.has(program.id("--verbose")));
+  CHECK(result.value(program.id("--verbose")).empty());
+  CHECK(result.has(program.id("--threads")));
+  CHECK(result.value(program.id("--threads")) == "4");
+  CHECK(result.value(program.id("--name")) == "x");
+  CHECK(!result.has(program.id("--other")));
+  CHECK(!result.has(100));
+  auto copy = result;
+  CHECK(copy.value(1) == "4");
+}
+
+TEST_CASE("Repeated option sees each value")
+{
+  Program program("test");
+  std::vector<std::string> values;
+  program.optional("--value", [&](const Option& o) { values.push_back(o.value); });
+  std::vector<std::string> args = {"--value", "1", "--value=2"};
+  program.parse(args.begin(), args.end());
+  CHECK(values == std::vector<std::string>{"1", "2"});
+}
+
+TEST_CASE("Replay an encoded parse result")
+{
+  struct state_t
+  {
+    int verbose = 0;
+    std::vector<std::string> values;
+    std::vector<std::string> args;
+  };
+  auto build = [](Program& program, state_t& state) {
+    program.optional("--other", []() {})
+      .args(0, 0)
+      .optional("--verbose", [&state]() { ++state.verbose; })
+      .optional("--value", [&state](const Option& o) { state.values.push_back(o.value); })
+      .args(0, {}, [&state](const std::string& arg) { state.args.push_back(arg); });
+  };
+  state_t parent_state;
+  Program parent("test");
+  build(parent, parent_state);
+  std::vector<std::string> args = {"--verbose", "--value", "1", "--verbose", "--value=2", "x", "y"};
+  ParseResult result;
+  parent.parse(args.begin(), args.end(), result);
+  CHECK(result.group() == 1);
+  CHECK(result.occurrences().size() == 4);
+  CHECK(result.args() == std::vector<std::string_view>{"x", "y"});
+  auto blob = result.encode(parent.fingerprint());
+  args.clear();
+
+  state_t child_state;
+  Program child("test");
+  build(child, child_state);
+  REQUIRE(child.fingerprint() == parent.fingerprint());
+  auto decoded = child.decode(blob);
+  child.replay(decoded);
+  CHECK(child_state.verbose == 2);
+  CHECK(child_state.values == std::vector<std::string>{"1", "2"});
+  CHECK(child_state.args == std::vector<std::string>{"x", "y"});
+  CHECK(decoded.value(child.id("--value")) == "2");
+  CHECK(decoded.has(child.id("--verbose")));
+  CHECK(!decoded.has(child.id("--other")));
+
+  SECTION("Different program")
+  {
+    Program other("test");
+    other.optional("--verbose", []() {}).optional("--value", [](const Option&) {});
+    CHECK(other.fingerprint() != parent.fingerprint());
+    CHECK_THROWS_WITH(other.decode(blob), "ParseResult: encoded by a different program");
+  }
+  SECTION("Corrupt blob")
+  {
+    CHECK_THROWS_WITH(child.decode(blob.substr(0, blob.size() - 1)),
+      "ParseResult: bad table offsets");
+    CHECK_THROWS_WITH(child.decode(blob.substr(0, 8)), "ParseResult: bad blob");
+    CHECK_THROWS_WITH(ParseResult::decode(blob, child.fingerprint(), 1000000), "ParseResult: bad number of option ids");
+    blob[0] = 'X';
+    CHECK_THROWS_WITH(child.decode(blob), "ParseResult: bad magic number");
+  }
+}
+
+TEST_CASE("Interned option names")
+{
+  StringPool pool;
+  auto a = pool.intern("--verbose"s);
+  auto b = pool.intern("--verbose"s);
+  CHECK(a == "--verbose");
+  CHECK(a.data() == b.data());
+  CHECK(pool.id("--verbose") == 0);
+  CHECK(pool.id("--quiet") == 1);
+  CHECK(pool.str(1) == "--quiet");
+  CHECK(pool.size() == 2);
+  CHECK(pool.bytes() > 0);
+  auto names = std::make_shared<StringPool>();
+  std::weak_ptr<StringPool> own_names;
+  {
+    Program one("one", names);
+    one.optional("--shared-name", []() {});
+    auto size = names->size();
+    Program two("two", names);
+    two.optional("--shared-name", []() {});
+    CHECK(two.names() == names);
+    CHECK(names->size() == size);
+    Program own("own");
+    own.optional("--shared-name", []() {});
+    CHECK(own.names() != names);
+    CHECK(own.names()->size() == 1);
+    own_names = own.names();
+  }
+  // A program's own pool is freed with the program.
+  CHECK(own_names.expired());
+  CHECK(names.use_count() == 1);
+}
+
+TEST_CASE("Options from a static table")
+{
+  static constexpr OptionSpec specs[] = {
+    {"--zeta", false, true},
+    {"--alpha", true, false},
+    {"--mid", false, false},
+  };
+  Program program("test");
+  program.options(specs);
+  CHECK(program.id("--zeta") == 0);
+  CHECK(program.id("--alpha") == 1);
+  CHECK(program.id("--mid") == 2);
+  std::vector<std::string> args = {"--alpha", "--zeta", "z"};
+  ParseResult result;
+  program.parse(args.begin(), args.end(), result);
+  CHECK(result.has(1));
+  CHECK(result.value(0) == "z");
+  CHECK(!result.has(2));
+  CHECK(program.help() == std::vector<std::string>{"test --alpha [--mid] [--zeta <value>]"});
+}
+
+TEST_CASE("Add options to the current group after a parse")
+{
+  static constexpr OptionSpec specs[] = {{"--b"}};
+  Program program("test");
+  program.optional("--a", []() {});
+  std::vector<std::string> args = {"--a"};
+  program.parse(args.begin(), args.end());
+  program.options(specs);
+  args = {"--b"};
+  CHECK(!program.validate(args.begin(), args.end()));
+  CHECK_NOTHROW(program.parse(args.begin(), args.end()));
+  CHECK(program.help() == std::vector<std::string>{"test [--a]", "test [--b]"});
+}
+
+TEST_CASE("Duplicate options in a static table")
+{
+  static constexpr std::array<OptionSpec, 3> specs = {{{"--a"}, {"--b"}, {"--a"}}};
+  Program program("test");
+  CHECK_THROWS_WITH(program.options(specs), "Program::options: duplicate option: --a");
+  Program other("test");
+  other.optional("--b", []() {});
+  CHECK_THROWS(other.options(specs.data(), specs.data() + 2));
+}
+
+TEST_CASE("Complete option names")
+{
+  Program program("test");
+  program.optional("--verbose", []() {})
+    .optional("--version", []() {})
+    .optional("--file", [](const Option&) {})
+    .args(0, 1);
+  SECTION("Partial option")
+  {
+    std::vector<std::string> args = {"--ver"};
+    CHECK(program.complete(args.begin(), args.end()) == std::vector<std::string>{"--verbose", "--version"});
+  }
+  SECTION("Empty word")
+  {
+    std::vector<std::string> args = {"--verbose", ""};
+    CHECK(program.complete(args.begin(), args.end()) == std::vector<std::string>{"--file", "--verbose", "--version"});
+  }
+  SECTION("Option value")
+  {
+    std::vector<std::string> args = {"--file", "--v"};
+    CHECK(program.complete(args.begin(), args.end()).empty());
+  }
+  SECTION("After a positional argument")
+  {
+    std::vector<std::string> args = {"arg", "--v"};
+    CHECK(program.complete(args.begin(), args.end()).empty());
+  }
+  SECTION("After --")
+  {
+    std::vector<std::string> args = {"--", "--v"};
+    CHECK(program.complete(args.begin(), args.end()).empty());
+  }
+}
+
+TEST_CASE("Validate without callbacks")
+{
+  int calls = 0;
+  Program program("test");
+  program.required("--count", [&calls](const Option&) { ++calls; })
+    .check("--count", [](std::string_view v) { return !v.empty() && v.find_first_not_of("0123456789") == v.npos; })
+    .optional("--verbose", [&calls]() { ++calls; })
+    .args(1, 1)
+    .optional("--help", [&calls]() { ++calls; })
+    .args();
+  auto validate = [&program](std::vector<std::string> args) { return program.validate(args.begin(), args.end()); };
+  CHECK(!validate({"--count", "3", "file"}));
+  CHECK(!validate({"--count=3", "--verbose", "--", "file"}));
+  CHECK(!validate({"--help"}));
+  CHECK(validate({"--count", "x", "file"}) == "invalid option value: x");
+  CHECK(validate({"--count=x", "file"}) == "invalid option value: --count=x");
+  CHECK(validate({"--verbose=1"}) == "illegal option value: --verbose=1");
+  CHECK(validate({"--bad"}) == "unknown option: --bad");
+  CHECK(validate({"--verbose"}) == "missing required argument: --count");
+  CHECK(validate({"--count"}) == "missing required argument: --count");
+  CHECK(validate({"--count", "3"}) == "wrong number of arguments");
+  CHECK(calls == 0);
+  std::vector<std::string> args = {"--count", "x", "file"};
+  CHECK_THROWS_WITH(program.parse(args.begin(), args.end()), Catch::Matchers::ContainsSubstring("invalid option value: x"));
+  CHECK(calls == 0);
+}
+
+TEST_CASE("Validate allocates nothing when a later group is selected")
+{
+  Program program("test");
+  program.abbreviations()
+    .required("--count", [](const Option&) {})
+    .optional("--verbose", []() {})
+    .optional("--version", []() {})
+    .optional("--json", []() {})
+    .optional("--yaml", []() {})
+    .exclusive({"--json", "--yaml"})
+    .args(1, 1)
+    .optional("--ver", []() {})
+    .optional("--json", []() {})
+    .optional("--yaml", []() {})
+    .optional("--help", []() {})
+    .args();
+  auto validate = [&program](std::vector<std::string>& args) {
+    auto before = allocations;
+    auto result = program.validate(args.begin(), args.end());
+    CHECK(allocations == before);
+    return result;
+  };
+  // The first group fails with an unknown option with a suggestion, an
+  // ambiguous abbreviation, a violated constraint, and a missing option.
+  std::vector<std::string> unknown = {"--help"};
+  CHECK(!validate(unknown));
+  std::vector<std::string> ambiguous = {"--ver"};
+  CHECK(!validate(ambiguous));
+  std::vector<std::string> conflicting = {"--json", "--yaml"};
+  CHECK(!validate(conflicting));
+  std::vector<std::string> missing = {"--json"};
+  CHECK(!validate(missing));
+  std::vector<std::string> first = {"--count=3", "file"};
+  CHECK(!validate(first));
+  // The error of the first group is still reported when no group matches.
+  std::vector<std::string> args = {"--json", "--yaml", "a", "b"};
+  CHECK(program.validate(args.begin(), args.end()) == "conflicting options: --json --yaml");
+  args = {"--ver", "--bad"};
+  CHECK(program.validate(args.begin(), args.end()) == "ambiguous option: --ver (--verbose --version)");
+  args = {"--jsno"};
+  CHECK(program.validate(args.begin(), args.end()) == "unknown option: --jsno (did you mean --json?)");
+}
+
+TEST_CASE("Option constraints")
+{
+  std::vector<std::string> calls;
+  auto call = [&calls](const std::string& name) { return [&calls, name]() { calls.push_back(name); }; };
+  Program program("test");
+  program.optional("--json", call("json"))
+    .optional("--yaml", call("yaml"))
+    .optional("--sign", call("sign"))
+    .optional("--key", [&calls](const Option& o) { calls.push_back(o.value); })
+    .exclusive({"--json", "--yaml"})
+    .implies("--sign", {"--key"})
+    .at_least_one({"--json", "--yaml"})
+    .args(0, {});
+  auto parse = [&program](std::vector<std::string> args) {
+    program.parse(args.begin(), args.end());
+  };
+  auto validate = [&program](std::vector<std::string> args) { return program.validate(args.begin(), args.end()); };
+  SECTION("Satisfied")
+  {
+    parse({"--yaml", "--sign", "--key", "k", "file"});
+    CHECK(calls == std::vector<std::string>{"yaml", "sign", "k"});
+    CHECK(!validate({"--json", "--", "--yaml"}));
+  }
+  SECTION("Exclusive")
+  {
+    CHECK_THROWS_WITH(parse({"--yaml", "--json"}),
+      Catch::Matchers::ContainsSubstring("conflicting options: --json --yaml"));
+    CHECK(validate({"--json", "--yaml"}) == "conflicting options: --json --yaml");
+  }
+  SECTION("Implies")
+  {
+    CHECK_THROWS_WITH(parse({"--json", "--sign"}), Catch::Matchers::ContainsSubstring("option --sign requires: --key"));
+    CHECK(validate({"--json", "--sign", "file"}) == "option --sign requires: --key");
+  }
+  SECTION("At least one")
+  {
+    CHECK_THROWS_WITH(parse({"--key", "k"}), Catch::Matchers::ContainsSubstring("missing one of: --json --yaml"));
+    CHECK(validate({"--key", "k"}) == "missing one of: --json --yaml");
+  }
+  SECTION("Token of the first conflicting option")
+  {
+    program.explain();
+    auto token = [&program]() {
+      REQUIRE(!program.decisions().empty());
+      CHECK(program.decisions()[0].code == error_code::constraint);
+      return program.decisions()[0].token;
+    };
+    CHECK_THROWS(parse({"--sign", "--yaml", "--key", "k", "--json"}));
+    CHECK(token() == 1);
+    CHECK_THROWS(parse({"--json", "--sign"}));
+    CHECK(token() == 1);
+    CHECK_THROWS(parse({"--key", "k"}));
+    CHECK(token() == argument_error::no_token);
+  }
+  CHECK_THROWS(program.exclusive({"--none"}));
+}
+
+TEST_CASE("Environment variable fallback")
+{
+  ::setenv("OPTION_TEST_THREADS", "8", 1);
+  ::setenv("OPTION_TEST_VERBOSE", "1", 1);
+  ::setenv("OPTION_TEST_QUIET", "0", 1);
+  std::string threads;
+  bool verbose = false;
+  bool quiet = false;
+  Program program("test");
+  program.required("--threads", [&threads](const Option& o) { threads = o.value; })
+    .env("--threads", "OPTION_TEST_THREADS")
+    .check("--threads", [](std::string_view v) { return v.find_first_not_of("0123456789") == v.npos; })
+    .optional("--verbose", [&verbose]() { verbose = true; })
+    .env("--verbose", "OPTION_TEST_VERBOSE")
+    .optional("--quiet", [&quiet]() { quiet = true; })
+    .env("--quiet", "OPTION_TEST_QUIET")
+    .args(0, {});
+  SECTION("Environment")
+  {
+    std::vector<std::string> args;
+    CHECK(!program.validate(args.begin(), args.end()));
+    program.parse(args.begin(), args.end());
+    CHECK(threads == "8");
+    CHECK(verbose);
+    CHECK(!quiet);
+  }
+  SECTION("Command line takes precedence")
+  {
+    std::vector<std::string> args = {"--threads", "2", "file"};
+    program.parse(args.begin(), args.end());
+    CHECK(threads == "2");
+    args = {"file"};
+    program.parse(args.begin(), args.end());
+    CHECK(threads == "8");
+  }
+  SECTION("Invalid value")
+  {
+    ::setenv("OPTION_TEST_THREADS", "many", 1);
+    std::vector<std::string> args = {"file"};
+    CHECK(program.validate(args.begin(), args.end()) == "invalid option value: OPTION_TEST_THREADS=many");
+    CHECK_THROWS_WITH(program.parse(args.begin(), args.end()),
+      Catch::Matchers::ContainsSubstring("invalid option value: OPTION_TEST_THREADS=many"));
+  }
+  SECTION("Variables of a later group")
+  {
+    // Without --threads the first group fails.  The second has more
+    // variables than are kept inside the resolved environment.
+    ::unsetenv("OPTION_TEST_THREADS");
+    std::vector<std::string> values(20);
+    for(std::size_t i = 0; i < values.size(); ++i)
+    {
+      auto name = "--value" + std::to_string(i);
+      auto variable = "OPTION_TEST_VALUE" + std::to_string(i);
+      ::setenv(variable.c_str(), std::to_string(i).c_str(), 1);
+      program.optional(name, [&values, i](const Option& o) { values[i] = o.value; }).env(name, variable);
+    }
+    program.args(0, 0);
+    std::vector<std::string> args;
+    CHECK(!program.validate(args.begin(), args.end()));
+    program.parse(args.begin(), args.end());
+    CHECK(threads.empty());
+    for(std::size_t i = 0; i < values.size(); ++i)
+    {
+      CHECK(values[i] == std::to_string(i));
+      ::unsetenv(("OPTION_TEST_VALUE" + std::to_string(i)).c_str());
+    }
+  }
+  ::unsetenv("OPTION_TEST_THREADS");
+  ::unsetenv("OPTION_TEST_VERBOSE");
+  ::unsetenv("OPTION_TEST_QUIET");
+}
+
+TEST_CASE("Layered configuration files")
+{
+  auto dir = std::filesystem::temp_directory_path();
+  auto system = dir / "option-system.conf";
+  auto user = dir / "option-user.conf";
+  auto project = dir / "option-project.conf";
+  std::ofstream(system) << "# System defaults\nthreads = 2\nlevel = low\nverbose = 1\nunknown = x\n";
+  std::ofstream(user) << "  level=medium  \r\n\nverbose = 0\n";
+  std::ofstream(project) << "threads = 4\n";
+  std::string threads;
+  std::string level;
+  bool verbose = false;
+  Program program("test");
+  program.optional("--threads", [&threads](const Option& o) { threads = o.value; })
+    .optional("--level", [&level](const Option& o) { level = o.value; })
+    .optional("--verbose", [&verbose]() { verbose = true; })
+    .config(system)
+    .config(user)
+    .config(dir / "option-missing.conf")
+    .config(project)
+    .args(0, {});
+  SECTION("Precedence")
+  {
+    std::vector<std::string> args = {"--level", "high"};
+    program.parse(args.begin(), args.end());
+    CHECK(threads == "4");
+    CHECK(level == "high");
+    CHECK(!verbose);
+  }
+  SECTION("Cached until changed")
+  {
+    auto first = ConfigFile::load(project);
+    CHECK(first == ConfigFile::load(project));
+    std::ofstream(project) << "threads = 16\n";
+    CHECK(first != ConfigFile::load(project));
+    std::vector<std::string> args;
+    program.parse(args.begin(), args.end());
+    CHECK(threads == "16");
+  }
+  SECTION("Syntax error")
+  {
+    std::ofstream(user) << "verbose\n";
+    std::vector<std::string> args;
+    CHECK_THROWS_WITH(program.validate(args.begin(), args.end()),
+      Catch::Matchers::ContainsSubstring("option-user.conf:1: expected key = value"));
+  }
+  CHECK(!ConfigFile::load(dir / "option-missing.conf"));
+  std::filesystem::remove(system);
+  std::filesystem::remove(user);
+  std::filesystem::remove(project);
+}
+
+TEST_CASE("Explain group selection")
+{
+  Program program("test");
+  program.explain()
+    .required("--input", [](const Option&) {})
+    .args(0, 0)
+    .optional("--list", []() {})
+    .args(1, 1)
+    .optional("--help", []() {})
+    .args();
+  SECTION("Rejected groups")
+  {
+    std::vector<std::string> args = {"--list", "--input"};
+    CHECK_THROWS(program.parse(args.begin(), args.end()));
+    auto& decisions = program.decisions();
+    REQUIRE(decisions.size() == 4);
+    CHECK(decisions[0].code == error_code::unknown_option);
+    CHECK(decisions[0].token == 0);
+    CHECK(decisions[1].code == error_code::unknown_option);
+    CHECK(decisions[1].token == 1);
+    CHECK(decisions[2].code == error_code::unknown_option);
+    CHECK(program.explanation(args.begin(), args.end())
+      == "group 0: rejected at argument 0 '--list': unknown option: --list\n"
+         "group 1: rejected at argument 1 '--input': unknown option: --input\n"
+         "group 2: rejected at argument 0 '--list': unknown option: --list\n"
+         "group 3: rejected at argument 0 '--list': unknown option: --list\n");
+  }
+  SECTION("Selected group")
+  {
+    std::vector<std::string> args = {"--list", "x"};
+    program.parse(args.begin(), args.end());
+    auto& decisions = program.decisions();
+    REQUIRE(decisions.size() == 2);
+    CHECK(decisions[0].code == error_code::unknown_option);
+    CHECK(decisions[1].code == error_code::none);
+    CHECK(decisions[1].token == 1);
+  }
+  SECTION("Argument count")
+  {
+    std::vector<std::string> args = {"--list"};
+    CHECK_THROWS(program.parse(args.begin(), args.end()));
+    auto& decisions = program.decisions();
+    REQUIRE(decisions.size() == 2);
+    CHECK(decisions[0].code == error_code::unknown_option);
+    CHECK(decisions[1].code == error_code::argument_count);
+    CHECK(decisions[1].token == 1);
+  }
+}
+
+TEST_CASE("Suggest the nearest option")
+{
+  Program program("test");
+  program.optional("--verbose", []() {})
+    .optional("--version", []() {})
+    .optional("--output", [](const Option&) {})
+    .args(0, 0);
+  auto validate = [&program](std::vector<std::string> args) { return program.validate(args.begin(), args.end()); };
+  CHECK(validate({"--outptu=x"}) == "unknown option: --outptu=x (did you mean --output?)");
+  CHECK(validate({"--verbos"}) == "unknown option: --verbos (did you mean --verbose?)");
+  CHECK(validate({"--versio"}) == "unknown option: --versio (did you mean --version?)");
+  CHECK(validate({"--verso"}) == "unknown option: --verso (did you mean --version?)");
+  CHECK(validate({"--zzz"}) == "unknown option: --zzz");
+  std::vector<std::string> args = {"--verbos"};
+  CHECK_THROWS_WITH(program.parse(args.begin(), args.end()),
+    Catch::Matchers::ContainsSubstring("unknown option: --verbos (did you mean --verbose?)"));
+}
+
+TEST_CASE("Edit distance")
+{
+  std::vector<std::string> words = {"", "a", "kitten", "sitting", "--verbose", "--vrebose", "flaw", "lawn",
+    "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"};
+  for(auto& a: words)
+    for(auto& b: words)
+    {
+      Nearest nearest(a, 1000);
+      nearest(b);
+      CHECK(nearest.distance() == edit_distance(a, b));
+    }
+  CHECK(edit_distance("kitten", "sitting") == 3);
+}
+
+TEST_CASE("Abbreviated options")
+{
+  std::string output;
+  bool verbose = false;
+  Program program("test");
+  program.optional("--verbose", [&verbose]() { verbose = true; })
+    .optional("--version", []() {})
+    .optional("--output", [&output](const Option& o) { output = o.value; })
+    .optional("--out", []() {})
+    .args(0, {});
+  std::vector<std::string> args = {"--verb", "--outp=file"};
+  CHECK(program.validate(args.begin(), args.end()) == "unknown option: --verb");
+  program.abbreviations();
+  CHECK(!program.validate(args.begin(), args.end()));
+  program.parse(args.begin(), args.end());
+  CHECK(verbose);
+  CHECK(output == "file");
+  args = {"--out", "--"};
+  CHECK(!program.validate(args.begin(), args.end()));
+  args = {"--ver"};
+  CHECK(program.validate(args.begin(), args.end()) == "ambiguous option: --ver (--verbose --version)");
+  CHECK_THROWS_WITH(program.parse(args.begin(), args.end()),
+    Catch::Matchers::ContainsSubstring("ambiguous option: --ver (--verbose --version)"));
+}
+
+TEST_CASE("Cache parse results")
+{
+  std::vector<std::string> outputs;
+  int verbose = 0;
+  std::vector<std::string> handled;
+  Program program("test");
+  program.optional("--verbose", [&verbose]() { ++verbose; })
+    .optional("--output", [&outputs](const Option& o) { outputs.emplace_back(o.value); })
+    .args(0, {}, [&handled](const std::string& arg) { handled.push_back(arg); });
+  program.cache(2);
+  ParseResult result;
+  auto id = program.id("--output");
+  std::vector<std::string> args = {"--verbose", "--output=a", "--output", "b", "x"};
+  auto rest = program.parse(args.begin(), args.end(), result);
+  CHECK(rest == args.begin() + 4);
+  std::vector<std::string> again = args;
+  rest = program.parse(again.begin(), again.end(), result);
+  CHECK(rest == again.begin() + 4);
+  CHECK(result.value(id).data() == again[3].data());
+  CHECK(verbose == 2);
+  CHECK(outputs == std::vector<std::string>{"a", "b", "a", "b"});
+  CHECK(handled == std::vector<std::string>{"x", "x"});
+  CHECK(program.cache_stats().hits == 1);
+  CHECK(program.cache_stats().misses == 1);
+
+  SECTION("Failed parse is not cached")
+  {
+    args = {"--verbsoe"};
+    CHECK_THROWS(program.parse(args.begin(), args.end()));
+    CHECK_THROWS(program.parse(args.begin(), args.end()));
+    CHECK(program.cache_stats().misses == 3);
+  }
+  SECTION("Least recently used line is evicted")
+  {
+    std::vector<std::string> one = {"--output", "1"};
+    std::vector<std::string> two = {"--output", "2"};
+    program.parse(one.begin(), one.end());
+    program.parse(args.begin(), args.end());
+    program.parse(two.begin(), two.end());
+    CHECK(program.cache_stats().evictions == 1);
+    program.parse(args.begin(), args.end());
+    CHECK(program.cache_stats().hits == 3);
+    program.parse(one.begin(), one.end());
+    CHECK(program.cache_stats().misses == 4);
+  }
+  SECTION("Adding an option clears the cache")
+  {
+    program.optional("--quiet", []() {});
+    program.parse(args.begin(), args.end());
+    CHECK(program.cache_stats().misses == 2);
+  }
+  SECTION("Adding options from a table clears the cache")
+  {
+    static constexpr OptionSpec specs[] = {{"--table"}};
+    program.options(specs);
+    program.parse(args.begin(), args.end());
+    CHECK(program.cache_stats().misses == 2);
+  }
+  SECTION("Line missing a required option is not cached")
+  {
+    Program required("test");
+    required.required("--input", [](const Option&) {}).optional("--quiet", []() {}).cache(4);
+    std::vector<std::string> given = {"--input", "x"};
+    required.parse(given.begin(), given.end());
+    std::vector<std::string> missing = {"--quiet"};
+    CHECK_THROWS_AS(required.parse(missing.begin(), missing.end()), usage_error);
+    CHECK_THROWS_AS(required.parse(missing.begin(), missing.end()), usage_error);
+    CHECK(required.cache_stats().hits == 0);
+    CHECK(required.cache_stats().misses == 3);
+  }
+  SECTION("Line over the byte budget is not cached")
+  {
+    program.cache(2, 16);
+    std::vector<std::string> small = {"--output", "1"};
+    std::vector<std::string> large = {"--output", std::string(16, 'x')};
+    program.parse(small.begin(), small.end());
+    program.parse(small.begin(), small.end());
+    program.parse(large.begin(), large.end());
+    program.parse(large.begin(), large.end());
+    CHECK(outputs.back() == large[1]);
+    CHECK(program.cache_stats().hits == 2);
+    CHECK(program.cache_stats().misses == 2);
+    CHECK(program.cache_stats().oversized == 2);
+  }
+}
+
+TEST_CASE("Resource limits")
+{
+  std::string output;
+  Program program("test");
+  program.optional("--verbose", []() {})
+    .optional("--output", [&output](const Option& o) { output = o.value; })
+    .args(0, {});
+  program.limits({4, 20, 8});
+  auto code = [&program](std::vector<std::string> args) {
+    try
+    {
+      program.parse(args.begin(), args.end());
+    }
+    catch(const argument_error& e)
+    {
+      return e.code();
+    }
+    return error_code::none;
+  };
+  CHECK(code({"--verbose", "--output", "file", "x"}) == error_code::none);
+  CHECK(output == "file");
+  CHECK(code({"--verbose", "x", "y", "z", "w"}) == error_code::limit_exceeded);
+  CHECK(code({"--verbose", "a-much-too-long-argument"}) == error_code::limit_exceeded);
+  CHECK(code({"--output", "long-file"}) == error_code::limit_exceeded);
+  CHECK(code({"--output=long-file"}) == error_code::limit_exceeded);
+  CHECK_THROWS_AS(code({"--unknown"}), usage_error);
+
+  std::vector<std::string> args = {"--output=long-file"};
+  CHECK(program.validate(args.begin(), args.end()) == "option value too long: --output");
+  args = {"x", "y", "z", "w", "v"};
+  CHECK(program.validate(args.begin(), args.end()) == "too many arguments: 5 (limit 4)");
+
+  SECTION("Repeated parses don't add groups")
+  {
+    for(int i = 0; i < 3; ++i)
+      code({"--verbose"});
+    CHECK(program.help().size() == 2);
+  }
+  SECTION("Numeric ranges")
+  {
+    CHECK(numeric_range("1-3,5", 0, 10, 4) == std::set<int>{1, 2, 3, 5});
+    CHECK(numeric_range("1-3,2-4", 0, 10, 4) == std::set<int>{1, 2, 3, 4});
+    CHECK_THROWS_AS(numeric_range("1-3,5-6", 0, 10, 4), std::runtime_error);
+    CHECK_THROWS_AS(numeric_range("-", std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), 1000),
+      std::runtime_error);
+    CHECK(numeric_range("2147483646-", 0, std::numeric_limits<int>::max()).size() == 2);
+  }
+}
+
+TEST_CASE("Numeric lists")
+{
+  CHECK(numeric_list<int>("").empty());
+  CHECK(numeric_list<int>("17") == std::vector<int>{17});
+  CHECK(numeric_list<int>("17,-42,0,1000000,3,4,5,6,7,8,9,10,11,12") ==
+    std::vector<int>{17, -42, 0, 1000000, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  CHECK(numeric_list<std::uint64_t>("18446744073709551615:1", ':') == std::vector<std::uint64_t>{~0ULL, 1});
+  CHECK(numeric_list<double>("0.5,-2,1e3") == std::vector<double>{0.5, -2.0, 1000.0});
+  // Plain decimals take a faster path than from_chars; both round the same.
+  CHECK(numeric_list<double>("0.1,-0.3,1.,.25,0.30000000000000004,9007199254740993,1.5E2")
+    == std::vector<double>{0.1, -0.3, 1.0, 0.25, 0.30000000000000004, 9007199254740993.0, 150.0});
+  CHECK(numeric_list<float>("0.1,-16777217,3.4028235e38")
+    == std::vector<float>{0.1F, -16777217.0F, 3.4028235e38F});
+  std::string ids;
+  for(int i = 0; i < 1000; ++i)
+    ids += std::to_string(i) + ",";
+  ids.pop_back();
+  auto list = numeric_list<int>(ids);
+  REQUIRE(list.size() == 1000);
+  CHECK(list.back() == 999);
+  CHECK_THROWS_AS(numeric_list<int>(ids, ',', 999), std::runtime_error);
+
+  CHECK_THROWS_WITH(numeric_list<int>("1,x2,3"), "bad number: x2");
+  CHECK_THROWS_WITH(numeric_list<int>("1,,3"), "bad number: ");
+  CHECK_THROWS_WITH(numeric_list<int>("1,2,"), "bad number: ");
+  CHECK_THROWS_WITH(numeric_list<int>("1,2x"), "bad number: 2x");
+  CHECK_THROWS_WITH(numeric_list<int>("1, 2"), "bad number:  2");
+  CHECK_THROWS_WITH(numeric_list<std::int8_t>("1,128"), "bad number: 128");
+  CHECK_THROWS_WITH(numeric_list<double>("1,+2"), "bad number: +2");
+  CHECK_THROWS_WITH(numeric_list<double>("1, 2"), "bad number:  2");
+  CHECK_THROWS_WITH(numeric_list<double>("0x10"), "bad number: 0x10");
+  CHECK_THROWS_WITH(numeric_list<double>("1,-"), "bad number: -");
+}
+
 int main(int argc, char* argv[])
 {
   int result = Catch::Session().run(argc, argv);
@@ -0,0 +1,484 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.hh"
+#include "Option.hh"
+#include "ParseResult.hh"
+#include "Program.hh"
+#include "parse_args.hh"
+#include "string_functions.hh"
+#include "suggest.hh"
+#include "usage.hh"
+
+namespace kuri::option
+{
+///
+/// @brief A read-only program schema stored in a binary blob.
+///
+/// @details
+///   The blob is created by `serialize` from a `Program` and contains the
+///   groups, the option names, flags and ids, the minimum and maximum number
+///   of arguments, the help strings, and a hash table of the option names of
+///   each group.  A `Schema` parses directly against the blob, typically a
+///   memory mapped file, without constructing any options.  There are no
+///   callbacks, the options found are recorded in a `ParseResult` using the
+///   same option ids as the `Program` the schema was created from.
+///
+///   The blob uses the byte order of the machine that created it.
+///
+class Schema
+{
+public:
+  /// @brief The magic number at the start of the blob ("KOPT").
+  static constexpr std::uint32_t magic = 0x54504f4b;
+  /// @brief The version of the format.
+  static constexpr std::uint32_t version = 1;
+
+  ///
+  /// @brief Creates a schema from a blob owned by the caller.
+  ///
+  /// @param data
+  ///   The blob.  The data must outlive the schema and be aligned to four
+  ///   bytes.
+  /// @throws std::runtime_error if the blob isn't a valid schema.
+  ///
+  explicit Schema(std::string_view data): _data(data) { validate(); }
+  ///
+  /// @brief Creates a schema from a memory mapped file.
+  ///
+  /// @param file The mapped file which is owned by the schema.
+  /// @throws std::runtime_error if the file isn't a valid schema.
+  ///
+  explicit Schema(MappedFile file): _file(std::move(file)), _data(_file->data()) { validate(); }
+
+  ///
+  /// @brief Serialize the schema of a program.
+  ///
+  /// @details
+  ///   The groups are the groups added so far followed by the current group
+  ///   unless it's already added, which are the groups `Program::parse`
+  ///   would consider, in the same order.
+  ///
+  ///   Only options, groups and the number of arguments are stored.  A
+  ///   program using a feature which changes the outcome of a parse but
+  ///   can't be stored is rejected rather than serialized into a schema that
+  ///   parses differently: option constraints and value checks,
+  ///   abbreviations, environment and configuration file fallback, and
+  ///   limits on the size of the arguments.
+  ///
+  /// @param program The program.
+  /// @return The blob.
+  /// @throws std::runtime_error if the program uses a feature the schema
+  ///   can't represent.
+  ///
+  static std::string serialize(const Program& program)
+  {
+    auto unsupported = [](const char* what) {
+      throw std::runtime_error(std::string("Schema::serialize: unsupported: ") + what);
+    };
+    std::vector<const Program::Group*> groups;
+    for(auto& g: program._groups)
+      groups.push_back(&g);
+    if(!program._added)
+      groups.push_back(&program._group);
+    if(program._abbreviations)
+      unsupported("abbreviations");
+    if(program._environment || !program._config.empty())
+      unsupported("environment or configuration fallback");
+    // The range size is only used by option callbacks, which a schema
+    // doesn't have.
+    constexpr auto no_limit = std::numeric_limits<std::size_t>::max();
+    auto& limits = program._limits;
+    if(limits.tokens != no_limit || limits.token_length != no_limit || limits.value_length != no_limit)
+      unsupported("limits");
+    for(const auto* g: groups)
+    {
+      if(!g->constraints.empty())
+        unsupported("constraints");
+      for(auto& [name, o]: g->valid_options)
+        if(o.check)
+          unsupported("value checks");
+    }
+
+    std::vector<group_t> group_table;
+    std::vector<option_t> option_table;
+    std::vector<std::uint32_t> hash_table;
+    std::string strings;
+    auto add_string = [&strings](std::string_view s) {
+      string_ref ref{static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(s.size())};
+      strings += s;
+      return ref;
+    };
+    for(const auto* g: groups)
+    {
+      group_t group{};
+      group.min_args = g->min_args ? *g->min_args : -1;
+      group.max_args = g->max_args ? *g->max_args : -1;
+      group.first_option = static_cast<std::uint32_t>(option_table.size());
+      group.options = static_cast<std::uint32_t>(g->valid_options.size());
+      group.help = add_string(program.help(*g));
+      for(auto& [name, o]: g->valid_options)
+      {
+        option_t option{};
+        option.name = add_string(name);
+        option.id = static_cast<std::uint32_t>(o.id);
+        option.flags = (o.required ? required_flag : 0) | (o.argument() ? argument_flag : 0);
+        option_table.push_back(option);
+      }
+      std::uint32_t hash_size = 1;
+      while(hash_size < 2 * group.options)
+        hash_size *= 2;
+      group.first_hash = static_cast<std::uint32_t>(hash_table.size());
+      group.hash_size = hash_size;
+      hash_table.resize(hash_table.size() + hash_size);
+      auto* hash = &hash_table[group.first_hash];
+      for(std::uint32_t i = 0; i < group.options; ++i)
+      {
+        auto& name = option_table[group.first_option + i].name;
+        auto h = fnv1a(std::string_view(strings).substr(name.offset, name.size)) & (hash_size - 1);
+        while(hash[h] != 0)
+          h = (h + 1) & (hash_size - 1);
+        hash[h] = i + 1;
+      }
+      group_table.push_back(group);
+    }
+
+    header_t header{};
+    header.magic = magic;
+    header.version = version;
+    header.ids = static_cast<std::uint32_t>(program._ids.size());
+    header.groups = static_cast<std::uint32_t>(group_table.size());
+    header.options = static_cast<std::uint32_t>(option_table.size());
+    header.hashes = static_cast<std::uint32_t>(hash_table.size());
+    header.groups_offset = sizeof(header_t);
+    header.options_offset = header.groups_offset + header.groups * sizeof(group_t);
+    header.hashes_offset = header.options_offset + header.options * sizeof(option_t);
+    header.strings_offset = header.hashes_offset + header.hashes * sizeof(std::uint32_t);
+    header.size = header.strings_offset + static_cast<std::uint32_t>(strings.size());
+
+    std::string blob;
+    blob.reserve(header.size);
+    auto append = [&blob](const void* data, std::size_t size) {
+      blob.append(static_cast<const char*>(data), size);
+    };
+    append(&header, sizeof(header));
+    append(group_table.data(), group_table.size() * sizeof(group_t));
+    append(option_table.data(), option_table.size() * sizeof(option_t));
+    append(hash_table.data(), hash_table.size() * sizeof(std::uint32_t));
+    blob += strings;
+    return blob;
+  }
+
+  ///
+  /// @brief Returns the number of option ids.
+  ///
+  std::size_t size() const noexcept { return header().ids; }
+
+  ///
+  /// @brief Returns the id of an option name.
+  ///
+  /// @param name The name of the option.
+  /// @return The option id.
+  ///
+  option_id id(std::string_view name) const
+  {
+    for(std::uint32_t g = 0; g < header().groups; ++g)
+      if(auto o = find(group(g), name); o)
+        return o->id;
+    throw std::runtime_error("Schema::id: unknown option: " + std::string(name));
+  }
+
+  ///
+  /// @brief Returns the help strings, one for each group.
+  ///
+  std::vector<std::string> help() const
+  {
+    std::vector<std::string> help_strings;
+    for(std::uint32_t g = 0; g < header().groups; ++g)
+      help_strings.emplace_back(string(group(g).help));
+    return help_strings;
+  }
+
+  ///
+  /// @brief Parse the arguments.
+  ///
+  /// @details
+  ///   Groups are tried in sequence like in `Program::parse` and the errors
+  ///   reported are the same.  The options of the selected group which are
+  ///   present on the command line are recorded in the result together
+  ///   with the selected group and the arguments after the options, so the
+  ///   result can be replayed by `Program::replay`.
+  ///
+  /// @param first, last
+  ///   The range of elements to parse.
+  /// @param result
+  ///   The options found are recorded here.
+  /// @return Returns the first iterator which is not an option.
+  ///
+  args_t::iterator parse(args_t::iterator first, args_t::iterator last, ParseResult& result) const
+  {
+    std::vector<std::string> errors;
+    for(std::uint32_t g = 0; g < header().groups; ++g)
+    {
+      try
+      {
+        result.reset(size());
+        auto rest = scan(first, last, group(g), result);
+        check_args(rest, last, group(g), errors);
+        result.finish(g, rest, last);
+        return rest;
+      }
+      catch(const argument_error& e)
+      {
+        errors.push_back(e.what());
+      }
+    }
+    option::usage(Error(errors), help());
+    throw;
+  }
+
+private:
+  /// @brief Flag set for required options.
+  static constexpr std::uint32_t required_flag = 1;
+  /// @brief Flag set for options taking a value.
+  static constexpr std::uint32_t argument_flag = 2;
+
+  /// @brief A string in the string table.
+  struct string_ref
+  {
+    std::uint32_t offset;
+    std::uint32_t size;
+  };
+  /// @brief The header at the start of the blob.
+  struct header_t
+  {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t size;
+    std::uint32_t ids;
+    std::uint32_t groups;
+    std::uint32_t options;
+    std::uint32_t hashes;
+    std::uint32_t groups_offset;
+    std::uint32_t options_offset;
+    std::uint32_t hashes_offset;
+    std::uint32_t strings_offset;
+  };
+  /// @brief A group.  Negative min and max means none.
+  struct group_t
+  {
+    std::int32_t min_args;
+    std::int32_t max_args;
+    std::uint32_t first_option;
+    std::uint32_t options;
+    std::uint32_t first_hash;
+    std::uint32_t hash_size;
+    string_ref help;
+  };
+  /// @brief An option.
+  struct option_t
+  {
+    string_ref name;
+    std::uint32_t id;
+    std::uint32_t flags;
+  };
+
+  /// @brief The mapped file if the schema owns the blob.
+  std::optional<MappedFile> _file;
+  /// @brief The blob.
+  std::string_view _data;
+
+  const header_t& header() const { return *reinterpret_cast<const header_t*>(_data.data()); }
+  const group_t& group(std::uint32_t g) const
+  {
+    return reinterpret_cast<const group_t*>(_data.data() + header().groups_offset)[g];
+  }
+  const option_t& option(std::uint32_t o) const
+  {
+    return reinterpret_cast<const option_t*>(_data.data() + header().options_offset)[o];
+  }
+  std::uint32_t hash(std::uint32_t h) const
+  {
+    return reinterpret_cast<const std::uint32_t*>(_data.data() + header().hashes_offset)[h];
+  }
+  std::string_view string(const string_ref& ref) const
+  {
+    return _data.substr(header().strings_offset + ref.offset, ref.size);
+  }
+
+  ///
+  /// @brief Checks that the blob is a schema, that all tables and strings
+  ///   are within the blob, and that every hash table has an entry for each
+  ///   option of its group.
+  ///
+  void validate() const
+  {
+    auto fail = [](const char* what) { throw std::runtime_error(std::string("Schema: ") + what); };
+    if(_data.size() < sizeof(header_t) || reinterpret_cast<std::uintptr_t>(_data.data()) % 4 != 0)
+      fail("bad blob");
+    auto& h = header();
+    if(h.magic != magic)
+      fail("bad magic number");
+    if(h.version != version)
+      fail("unsupported version");
+    if(h.size != _data.size() || h.groups_offset != sizeof(header_t)
+      || h.options_offset != h.groups_offset + std::uint64_t(h.groups) * sizeof(group_t)
+      || h.hashes_offset != h.options_offset + std::uint64_t(h.options) * sizeof(option_t)
+      || h.strings_offset != h.hashes_offset + std::uint64_t(h.hashes) * sizeof(std::uint32_t)
+      || h.strings_offset > h.size)
+      fail("bad table offsets");
+    auto strings = h.size - h.strings_offset;
+    auto check = [&](const string_ref& ref) {
+      if(ref.offset > strings || ref.size > strings - ref.offset)
+        fail("bad string");
+    };
+    for(std::uint32_t g = 0; g < h.groups; ++g)
+    {
+      auto& gr = group(g);
+      check(gr.help);
+      if(gr.first_option > h.options || gr.options > h.options - gr.first_option || gr.first_hash > h.hashes
+        || gr.hash_size == 0 || gr.hash_size > h.hashes - gr.first_hash || (gr.hash_size & (gr.hash_size - 1)) != 0
+        || gr.hash_size <= gr.options)
+        fail("bad group");
+      // Each option of the group must be in the hash table exactly once,
+      // which leaves at least one empty slot to end a probe in `find`.
+      std::vector<bool> found(gr.options);
+      std::uint32_t used = 0;
+      for(std::uint32_t i = 0; i < gr.hash_size; ++i)
+      {
+        auto entry = hash(gr.first_hash + i);
+        if(entry == 0)
+          continue;
+        if(entry > gr.options || found[entry - 1])
+          fail("bad hash table");
+        found[entry - 1] = true;
+        ++used;
+      }
+      if(used != gr.options)
+        fail("bad hash table");
+    }
+    for(std::uint32_t o = 0; o < h.options; ++o)
+    {
+      check(option(o).name);
+      if(option(o).id >= h.ids)
+        fail("bad option id");
+    }
+  }
+
+  ///
+  /// @brief Find an option in a group using its hash table.
+  ///
+  /// @param g The group.
+  /// @param name The name of the option.
+  /// @return The option or null if not found.
+  ///
+  const option_t* find(const group_t& g, std::string_view name) const
+  {
+    auto mask = g.hash_size - 1;
+    for(auto h = static_cast<std::uint32_t>(fnv1a(name)) & mask;; h = (h + 1) & mask)
+    {
+      auto i = hash(g.first_hash + h);
+      if(i == 0)
+        return nullptr;
+      auto& o = option(g.first_option + i - 1);
+      if(string(o.name) == name)
+        return &o;
+    }
+  }
+
+  ///
+  /// @brief Suggest the option in a group nearest to an unknown option.
+  ///   Same as `Program::suggest`.
+  ///
+  std::string_view suggest(const group_t& g, std::string_view arg) const
+  {
+    Nearest nearest(arg.substr(0, arg.find('=')));
+    for(std::uint32_t i = 0; i < g.options; ++i)
+      nearest(string(option(g.first_option + i).name));
+    return nearest.best();
+  }
+
+  ///
+  /// @brief Scan the range of arguments against a group.  Same as
+  ///   `Program::scan`.
+  ///
+  args_t::iterator scan(args_t::iterator first, args_t::iterator last, const group_t& g, ParseResult& result) const
+  {
+    const option_t* current_option = nullptr;
+    for(; first != last; ++first)
+    {
+      std::string_view arg = *first;
+      if(current_option)
+      {
+        result.set(current_option->id, arg);
+        current_option = nullptr;
+      }
+      else if(auto* o = find(g, arg); o)
+      {
+        if(o->flags & argument_flag)
+          current_option = o;
+        else
+          result.set(o->id);
+      }
+      else if(auto pos = arg.find_first_of('='); pos != std::string_view::npos && (o = find(g, arg.substr(0, pos))))
+      {
+        if(!(o->flags & argument_flag))
+          throw argument_error(error_code::illegal_value, "illegal option value: " + *first);
+        result.set(o->id, arg.substr(pos + 1));
+      }
+      else if(arg == "--")
+        return ++first;
+      else if(!arg.empty() && arg[0] == '-')
+        throw argument_error(error_code::unknown_option, "unknown option: " + *first + did_you_mean(suggest(g, arg)));
+      else
+        return first;
+    }
+    for(std::uint32_t i = 0; i < g.options; ++i)
+    {
+      auto& o = option(g.first_option + i);
+      if((o.flags & required_flag) && !result.has(o.id))
+        throw argument_error(
+          error_code::missing_required, "missing required argument: " + std::string(string(o.name)));
+    }
+    if(current_option)
+      throw argument_error(
+        error_code::missing_value, "missing option value: " + std::string(string(current_option->name)));
+    return first;
+  }
+
+  ///
+  /// @brief Verifies the number of arguments after the options.  Same as
+  ///   `Program::check_args`.
+  ///
+  void check_args(args_t::iterator first, args_t::iterator last, const group_t& g,
+    const std::vector<std::string>& errors) const
+  {
+    auto distance = std::distance(first, last);
+    if(g.min_args < 0 ? distance > 0 : (distance < g.min_args || (g.max_args >= 0 && distance > g.max_args)))
+      option::usage(Error(errors), help());
+  }
+};
+
+} // namespace kuri::option
@@ -0,0 +1,256 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "Schema.hh"
+#include "SchemaRegistry.hh"
+
+using namespace kuri::option;
+using namespace std::literals;
+
+namespace
+{
+Program make_program()
+{
+  Program program("test");
+  program.required("--verbose", []() {})
+    .optional("--threads", [](const Option&) {})
+    .args(0, 1)
+    .optional("--help", []() {});
+  return program;
+}
+} // namespace
+
+TEST_CASE("Schema round trip")
+{
+  auto program = make_program();
+  auto blob = Schema::serialize(program);
+  Schema schema(blob);
+  CHECK(schema.size() == 3);
+  CHECK(schema.id("--verbose") == program.id("--verbose"));
+  CHECK(schema.id("--threads") == program.id("--threads"));
+  CHECK(schema.id("--help") == program.id("--help"));
+  CHECK_THROWS(schema.id("--unknown"));
+  CHECK(schema.help() == std::vector<std::string>{"test [--threads <value>] --verbose [<arg>]", "test [--help]"});
+  ParseResult result;
+  SECTION("First group")
+  {
+    std::vector<std::string> args = {"--threads=4", "--verbose", "file"};
+    auto rest = schema.parse(args.begin(), args.end(), result);
+    CHECK(rest == args.begin() + 2);
+    CHECK(result.has(schema.id("--verbose")));
+    CHECK(result.value(schema.id("--threads")) == "4");
+    CHECK(!result.has(schema.id("--help")));
+  }
+  SECTION("Second group")
+  {
+    std::vector<std::string> args = {"--help"};
+    schema.parse(args.begin(), args.end(), result);
+    CHECK(result.has(schema.id("--help")));
+    CHECK(!result.has(schema.id("--verbose")));
+  }
+  SECTION("Errors are reported like Program")
+  {
+    std::vector<std::string> args = {"--threads"};
+    REQUIRE_THROWS_WITH(schema.parse(args.begin(), args.end(), result),
+      "missing required argument: --verbose\n"
+      "usage: test [--threads <value>] --verbose [<arg>]\n"
+      "       test [--help]");
+    args = {"--verbose", "1", "2"};
+    CHECK_THROWS_AS(schema.parse(args.begin(), args.end(), result), usage_error);
+  }
+  SECTION("Unknown options get the same suggestion as in Program")
+  {
+    std::vector<std::string> args = {"--verbos", "--threds=4"};
+    std::string expected;
+    try
+    {
+      program.parse(args.begin(), args.end());
+    }
+    catch(const usage_error& e)
+    {
+      expected = e.what();
+    }
+    CHECK_THAT(expected, Catch::Matchers::ContainsSubstring("unknown option: --verbos (did you mean --verbose?)"));
+    CHECK_THROWS_WITH(schema.parse(args.begin(), args.end(), result), expected);
+    args = {"--threds=4"};
+    CHECK_THROWS_WITH(schema.parse(args.begin(), args.end(), result),
+      Catch::Matchers::ContainsSubstring("unknown option: --threds=4 (did you mean --threads?)"));
+  }
+}
+
+TEST_CASE("Schema parse replayed by the program")
+{
+  int verbose = 0;
+  std::string threads;
+  std::vector<std::string> files;
+  Program program("test");
+  program.required("--verbose", [&verbose]() { ++verbose; })
+    .optional("--threads", [&threads](const Option& o) { threads = o.value; })
+    .args(0, 1, [&files](const std::string& arg) { files.push_back(arg); })
+    .optional("--help", []() {});
+  std::vector<std::string> args = {"--threads=4", "--verbose", "file"};
+  program.parse(args.begin(), args.end());
+  CHECK(Schema::serialize(program) == Schema::serialize(make_program()));
+  verbose = 0;
+  threads.clear();
+  files.clear();
+
+  auto blob = Schema::serialize(program);
+  Schema schema(blob);
+  REQUIRE(schema.help().size() == 2);
+  ParseResult result;
+  auto rest = schema.parse(args.begin(), args.end(), result);
+  CHECK(rest == args.begin() + 2);
+  CHECK(result.group() == 0);
+  CHECK(result.args() == std::vector<std::string_view>{"file"});
+  program.replay(result);
+  CHECK(verbose == 1);
+  CHECK(threads == "4");
+  CHECK(files == std::vector<std::string>{"file"});
+}
+
+TEST_CASE("Schema of a program with unsupported features")
+{
+  auto program = make_program();
+  program.optional("--jobs", [](const Option&) {});
+  auto unsupported = [](const std::string& what) { return "Schema::serialize: unsupported: " + what; };
+  CHECK_NOTHROW(Schema::serialize(program));
+  SECTION("Constraints")
+  {
+    program.exclusive({"--jobs", "--help"});
+    CHECK_THROWS_WITH(Schema::serialize(program), unsupported("constraints"));
+  }
+  SECTION("Value checks")
+  {
+    program.check("--jobs", [](std::string_view) { return true; });
+    CHECK_THROWS_WITH(Schema::serialize(program), unsupported("value checks"));
+  }
+  SECTION("Abbreviations")
+  {
+    program.abbreviations();
+    CHECK_THROWS_WITH(Schema::serialize(program), unsupported("abbreviations"));
+  }
+  SECTION("Environment")
+  {
+    program.env("--jobs", "OPTION_TEST_JOBS");
+    CHECK_THROWS_WITH(Schema::serialize(program), unsupported("environment or configuration fallback"));
+  }
+  SECTION("Configuration")
+  {
+    program.config("option-missing.conf");
+    CHECK_THROWS_WITH(Schema::serialize(program), unsupported("environment or configuration fallback"));
+  }
+  SECTION("Limits")
+  {
+    Program::limits_t limits;
+    limits.range_size = 10;
+    program.limits(limits);
+    CHECK_NOTHROW(Schema::serialize(program));
+    limits.tokens = 10;
+    program.limits(limits);
+    CHECK_THROWS_WITH(Schema::serialize(program), unsupported("limits"));
+  }
+}
+
+TEST_CASE("Schema from a mapped file")
+{
+  auto program = make_program();
+  auto path = std::filesystem::temp_directory_path() / "option-schema.test";
+  std::ofstream(path, std::ios::binary) << Schema::serialize(program);
+  Schema schema{MappedFile(path)};
+  std::filesystem::remove(path);
+  std::vector<std::string> args = {"--verbose"};
+  ParseResult result;
+  schema.parse(args.begin(), args.end(), result);
+  CHECK(result.has(program.id("--verbose")));
+}
+
+TEST_CASE("Invalid schema")
+{
+  auto blob = Schema::serialize(make_program());
+  CHECK_THROWS(Schema(std::string_view(blob).substr(0, 8)));
+  CHECK_THROWS(Schema(std::string_view(blob).substr(0, blob.size() - 1)));
+  auto bad = blob;
+  bad[0] = 'X';
+  CHECK_THROWS(Schema(bad));
+
+  // Header fields are 32 bit: the number of hash slots is at offset 24 and
+  // the offset of the hash table at offset 36.
+  std::uint32_t hashes = 0;
+  std::uint32_t hashes_offset = 0;
+  std::memcpy(&hashes, blob.data() + 24, sizeof(hashes));
+  std::memcpy(&hashes_offset, blob.data() + 36, sizeof(hashes_offset));
+  auto fill = [&](std::uint32_t entry) {
+    auto table = blob;
+    for(std::uint32_t i = 0; i < hashes; ++i)
+      std::memcpy(table.data() + hashes_offset + i * sizeof(entry), &entry, sizeof(entry));
+    return table;
+  };
+  CHECK_THROWS_WITH(Schema(fill(1)), "Schema: bad hash table");
+  CHECK_THROWS_WITH(Schema(fill(0)), "Schema: bad hash table");
+}
+
+TEST_CASE("Schema registry")
+{
+  auto directory = std::filesystem::temp_directory_path() / "option-registry.test";
+  std::filesystem::create_directories(directory);
+  auto path = directory / "schema";
+  auto write = [&](Program& program) {
+    auto tmp = directory / "schema.tmp";
+    std::ofstream(tmp, std::ios::binary) << Schema::serialize(program);
+    std::filesystem::rename(tmp, path);
+  };
+  Program first("first");
+  first.optional("--old", []() {});
+  write(first);
+  SchemaRegistry registry(path);
+  auto old = registry.get();
+  CHECK(old->help() == std::vector<std::string>{"first [--old]"});
+  Program second("second");
+  second.optional("--new", []() {});
+  SECTION("Reload")
+  {
+    write(second);
+    CHECK(registry.reload());
+    CHECK(registry.generation() == 1);
+    CHECK(registry.get()->help() == std::vector<std::string>{"second [--new]"});
+    // The old version is still usable by readers holding on to it.
+    CHECK(old->help() == std::vector<std::string>{"first [--old]"});
+    std::filesystem::remove(path);
+    CHECK(!registry.reload());
+    CHECK(registry.get()->help() == std::vector<std::string>{"second [--new]"});
+  }
+  SECTION("Watch")
+  {
+    registry.watch();
+    write(second);
+    for(auto i = 0; i < 500 && registry.generation() == 0; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    registry.stop();
+    CHECK(registry.generation() >= 1);
+    CHECK(registry.get()->help() == std::vector<std::string>{"second [--new]"});
+  }
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,231 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "MappedFile.hh"
+#include "Schema.hh"
+
+namespace kuri::option
+{
+///
+/// @brief Holds the current version of a schema loaded from a file and
+///   replaces it when the file changes.
+///
+/// @details
+///   Readers call `get` to obtain a reference to the current schema and
+///   parse against it.  A new version of the schema is loaded and validated
+///   outside of the readers' path and then published with an atomic pointer
+///   swap, so readers never wait for a reload.  A replaced schema is released
+///   when the last reader holding a reference to it lets go.
+///
+///   The schema file should be replaced by renaming a new file over the old
+///   one.  Writing to the mapped file in place changes the data seen by
+///   readers of the current version.
+///
+class SchemaRegistry
+{
+public:
+  ///
+  /// @brief Creates the registry and loads the initial schema.
+  ///
+  /// @param path The path of the schema file.
+  /// @throws std::system_error or std::runtime_error if the schema can't be
+  ///   loaded.
+  ///
+  explicit SchemaRegistry(std::filesystem::path path): _path(std::move(path))
+  {
+    std::atomic_store(&_schema, load());
+  }
+  ///
+  /// @brief Stops watching the file.
+  ///
+  ~SchemaRegistry() { stop(); }
+  ///
+  /// @brief No copying allowed.
+  ///
+  SchemaRegistry(const SchemaRegistry&) = delete;
+  SchemaRegistry& operator=(const SchemaRegistry&) = delete;
+
+  ///
+  /// @brief Returns the current schema.
+  ///
+  /// @return A reference to the schema which stays valid for as long as the
+  ///   caller holds on to it, even if a new version is published.
+  ///
+  std::shared_ptr<const Schema> get() const noexcept { return std::atomic_load(&_schema); }
+
+  ///
+  /// @brief Returns the number of times a new schema has been published.
+  ///
+  std::uint64_t generation() const noexcept { return _generation; }
+
+  ///
+  /// @brief Loads the schema file and publishes it.
+  ///
+  /// @return True if the new schema was published.  If the file can't be
+  ///   loaded the current schema is kept and false is returned.
+  ///
+  bool reload() noexcept
+  {
+    try
+    {
+      std::atomic_store(&_schema, load());
+      ++_generation;
+      return true;
+    }
+    catch(const std::exception&)
+    {
+      return false;
+    }
+  }
+
+  ///
+  /// @brief Starts a thread which reloads the schema whenever the file is
+  ///   replaced or written.
+  ///
+  /// @details
+  ///   On Linux the directory of the file is watched with inotify.  On other
+  ///   systems the modification time of the file is polled once a second.
+  ///
+  void watch()
+  {
+    if(_watcher.joinable())
+      return;
+    _stop = false;
+#ifdef __linux__
+    _inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(_inotify < 0)
+      throw std::system_error(errno, std::generic_category(), "SchemaRegistry: inotify_init1");
+    auto directory = _path.has_parent_path() ? _path.parent_path() : std::filesystem::path(".");
+    if(::inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0
+      || (_event = ::eventfd(0, EFD_CLOEXEC)) < 0)
+    {
+      auto error = errno;
+      close();
+      throw std::system_error(error, std::generic_category(), "SchemaRegistry: " + directory.string());
+    }
+#endif
+    _watcher = std::thread([this]() { run(); });
+  }
+
+  ///
+  /// @brief Stops the thread started by `watch`.
+  ///
+  void stop()
+  {
+    if(!_watcher.joinable())
+      return;
+    _stop = true;
+#ifdef __linux__
+    std::uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(_event, &one, sizeof(one));
+#endif
+    _watcher.join();
+    close();
+  }
+
+private:
+  /// @brief The path of the schema file.
+  std::filesystem::path _path;
+  /// @brief The current schema.  Only accessed with the atomic shared_ptr
+  ///   functions.
+  std::shared_ptr<const Schema> _schema;
+  /// @brief Number of schemas published after the initial one.
+  std::atomic<std::uint64_t> _generation = 0;
+  /// @brief The watcher thread.
+  std::thread _watcher;
+  /// @brief Set to stop the watcher thread.
+  std::atomic<bool> _stop = false;
+  /// @brief The inotify and event file descriptors.
+  int _inotify = -1;
+  int _event = -1;
+
+  ///
+  /// @brief Load and validate the schema file.
+  ///
+  std::shared_ptr<const Schema> load() const { return std::make_shared<const Schema>(MappedFile(_path)); }
+
+  ///
+  /// @brief The body of the watcher thread.
+  ///
+  void run()
+  {
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[4096];
+    pollfd fds[2] = {{_inotify, POLLIN, 0}, {_event, POLLIN, 0}};
+    while(!_stop)
+    {
+      if(::poll(fds, 2, -1) < 0)
+        continue;
+      if(fds[1].revents != 0)
+        break;
+      bool changed = false;
+      for(auto n = ::read(_inotify, buffer, sizeof(buffer)); n > 0; n = ::read(_inotify, buffer, sizeof(buffer)))
+        for(char* p = buffer; p < buffer + n;)
+        {
+          auto* event = reinterpret_cast<struct inotify_event*>(p);
+          if(event->len > 0 && _path.filename() == event->name)
+            changed = true;
+          p += sizeof(struct inotify_event) + event->len;
+        }
+      if(changed)
+        reload();
+    }
+#else
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(_path, ec);
+    while(!_stop)
+    {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      auto t = std::filesystem::last_write_time(_path, ec);
+      if(!ec && t != mtime && reload())
+        mtime = t;
+    }
+#endif
+  }
+
+  ///
+  /// @brief Close the file descriptors used by the watcher.
+  ///
+  void close()
+  {
+    if(_inotify >= 0)
+      ::close(_inotify);
+    if(_event >= 0)
+      ::close(_event);
+    _inotify = -1;
+    _event = -1;
+  }
+};
+
+} // namespace kuri::option
@@ -0,0 +1,162 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace kuri::option
+{
+///
+/// @brief A pool of interned strings.
+///
+/// @details
+///   Each distinct string is stored once and gets a small integer id.  The
+///   returned views stay valid for the lifetime of the pool.  Strings are
+///   copied into chunks, doubling in size up to 16 KiB, to avoid one
+///   allocation per string.  All member functions are thread safe.
+///
+///   Each `Program` and `Commands` object interns its names in a pool held
+///   by a `std::shared_ptr`.  Objects given the same pool share the storage
+///   of the names they have in common, and the pool is freed with the last
+///   of them.
+///
+class StringPool
+{
+public:
+  /// @brief Type of the id of an interned string.
+  using id_t = std::uint32_t;
+
+  ///
+  /// @brief Creates an empty pool.
+  ///
+  StringPool() = default;
+  ///
+  /// @brief No copying allowed.
+  ///
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  ///
+  /// @brief Intern a string.
+  ///
+  /// @param s The string.
+  /// @return A view of the interned copy of the string.
+  ///
+  std::string_view intern(std::string_view s) { return str(id(s)); }
+
+  ///
+  /// @brief Intern a string and return its id.
+  ///
+  /// @param s The string.
+  /// @return The id of the string.
+  ///
+  id_t id(std::string_view s)
+  {
+    std::lock_guard lock(_mutex);
+    if(auto i = _index.find(s); i != _index.end())
+      return i->second;
+    auto copy = store(s);
+    auto id = static_cast<id_t>(_strings.size());
+    _strings.push_back(copy);
+    _index.emplace(copy, id);
+    return id;
+  }
+
+  ///
+  /// @brief Returns the string with the given id.
+  ///
+  /// @param id The id of an interned string.
+  ///
+  std::string_view str(id_t id) const
+  {
+    std::lock_guard lock(_mutex);
+    return _strings[id];
+  }
+
+  ///
+  /// @brief Returns the number of distinct strings.
+  ///
+  std::size_t size() const
+  {
+    std::lock_guard lock(_mutex);
+    return _strings.size();
+  }
+
+  ///
+  /// @brief Returns an estimate of the memory used by the pool in bytes.
+  ///
+  /// @details
+  ///   Includes the character storage, the id table, and the index.
+  ///
+  std::size_t bytes() const
+  {
+    std::lock_guard lock(_mutex);
+    return _chunk_bytes + _strings.capacity() * sizeof(std::string_view)
+      + _index.bucket_count() * sizeof(void*)
+      + _index.size() * (sizeof(std::pair<std::string_view, id_t>) + 2 * sizeof(void*));
+  }
+
+private:
+  /// @brief Sizes of the first and the largest chunks of character
+  ///   storage.
+  static constexpr std::size_t first_chunk_size = 256;
+  static constexpr std::size_t chunk_size = 16384;
+
+  /// @brief Protects all members.
+  mutable std::mutex _mutex;
+  /// @brief Chunks of character storage.
+  std::vector<std::unique_ptr<char[]>> _chunks;
+  /// @brief Total number of bytes in all chunks.
+  std::size_t _chunk_bytes = 0;
+  /// @brief Free space at the end of the last chunk.
+  char* _free = nullptr;
+  std::size_t _available = 0;
+  /// @brief The interned strings indexed by id.
+  std::vector<std::string_view> _strings;
+  /// @brief Map from string to id.
+  std::unordered_map<std::string_view, id_t> _index;
+
+  ///
+  /// @brief Copy a string into the character storage.
+  ///
+  std::string_view store(std::string_view s)
+  {
+    if(s.empty())
+      return {};
+    if(s.size() > _available)
+    {
+      auto size = std::max(std::min(std::max(first_chunk_size, 2 * _chunk_bytes), chunk_size), s.size());
+      _chunks.push_back(std::make_unique<char[]>(size));
+      _chunk_bytes += size;
+      _free = _chunks.back().get();
+      _available = size;
+    }
+    std::memcpy(_free, s.data(), s.size());
+    std::string_view copy(_free, s.size());
+    _free += s.size();
+    _available -= s.size();
+    return copy;
+  }
+};
+
+} // namespace kuri::option
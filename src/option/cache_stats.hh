@@ -0,0 +1,37 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+namespace kuri::option
+{
+///
+/// @brief Counters of the lookups in a `ParseCache`.
+///
+struct cache_stats_t
+{
+  /// @brief Lookups which found an entry.
+  std::size_t hits = 0;
+  /// @brief Lookups which didn't find an entry.
+  std::size_t misses = 0;
+  /// @brief Entries evicted to make room for new entries.
+  std::size_t evictions = 0;
+  /// @brief Lookups of command lines over the byte budget, which are
+  ///   neither looked up nor cached.
+  std::size_t oversized = 0;
+};
+
+} // namespace kuri::option
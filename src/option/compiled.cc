@@ -0,0 +1,27 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// The only translation unit of the compiled library.  It defines the
+// functions which the headers only declare when KURI_OPTION_COMPILED is
+// defined.
+
+#ifndef KURI_OPTION_COMPILED
+#define KURI_OPTION_COMPILED
+#endif
+#ifndef KURI_OPTION_SOURCE
+#define KURI_OPTION_SOURCE
+#endif
+
+#include "Program.hh"
@@ -0,0 +1,44 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+///
+/// @file
+/// @brief Selects between the header-only and the compiled library.
+///
+/// @details
+///   By default the library is header-only and every function is defined
+///   inline in the headers.  When `KURI_OPTION_COMPILED` is defined, for
+///   example by configuring with `-DOPTION_COMPILED=ON`, the non-template
+///   functions which are expensive to compile are only declared in the
+///   headers and are defined once in the `option_compiled` library, which is
+///   built from `compiled.cc` with `KURI_OPTION_SOURCE` defined.  All
+///   translation units of a program must agree on `KURI_OPTION_COMPILED`.
+///
+
+#if defined(KURI_OPTION_COMPILED) && !defined(KURI_OPTION_SOURCE)
+/// @brief True if the headers define the non-template functions.
+#define KURI_OPTION_DEFINITIONS 0
+#else
+#define KURI_OPTION_DEFINITIONS 1
+#endif
+
+#ifdef KURI_OPTION_COMPILED
+/// @brief Linkage of functions defined in `compiled.cc` in the compiled
+///   library and in the headers otherwise.
+#define KURI_OPTION_INLINE
+#else
+#define KURI_OPTION_INLINE inline
+#endif
@@ -0,0 +1,106 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+namespace kuri::option
+{
+///
+/// @brief The name of the environment variable set by the completion scripts.
+///
+inline constexpr const char* completion_variable = "OPTION_COMPLETE";
+
+///
+/// @brief Returns true if the program is run by a shell completion script.
+///
+/// @details
+///   The completion scripts generated by `completion_script` run the program
+///   with the environment variable `OPTION_COMPLETE` set and the words of the
+///   command line, up to and including the word being completed, as
+///   arguments.  The program should then print the candidates returned by
+///   `Program::complete` or `Commands::complete`, one per line, and exit
+///   without running any callbacks.
+///
+/// @code
+///   option::args_t args{argv + 1, argv + argc};
+///   if(option::completion_requested())
+///   {
+///     for(auto& c: program.complete(args.begin(), args.end()))
+///       std::cout << c << '\n';
+///     return 0;
+///   }
+/// @endcode
+///
+inline bool completion_requested() { return std::getenv(completion_variable) != nullptr; }
+
+///
+/// @brief Generate a shell completion script for a program.
+///
+/// @details
+///   The script registers a completion function for the program which runs
+///   the program in completion mode.  When there are no candidates the shell
+///   falls back to completing file names.
+///
+/// @param shell
+///   One of "bash", "zsh", or "fish".
+/// @param program
+///   The name of the program.
+///
+/// @return The script.
+/// @throws std::invalid_argument for an unknown shell.
+///
+inline std::string completion_script(std::string_view shell, std::string_view program)
+{
+  std::string function = "_";
+  for(auto c: program)
+    function += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  function += "_complete";
+  if(shell == "bash")
+    return fmt::format(
+      "{0}() {{\n"
+      "  local IFS=$'\\n'\n"
+      "  COMPREPLY=($({2}=1 \"${{COMP_WORDS[0]}}\" \"${{COMP_WORDS[@]:1:COMP_CWORD}}\" 2>/dev/null))\n"
+      "}}\n"
+      "complete -o default -F {0} {1}\n",
+      function, program, completion_variable);
+  if(shell == "zsh")
+    return fmt::format(
+      "#compdef {1}\n"
+      "{0}() {{\n"
+      "  local -a candidates\n"
+      "  candidates=(\"${{(@f)$({2}=1 ${{words[1]}} \"${{(@)words[2,CURRENT]}}\" 2>/dev/null)}}\")\n"
+      "  if (( ${{#candidates[@]}} > 0 )) && [[ -n ${{candidates[1]}} ]]; then\n"
+      "    compadd -a candidates\n"
+      "  else\n"
+      "    _files\n"
+      "  fi\n"
+      "}}\n"
+      "compdef {0} {1}\n",
+      function, program, completion_variable);
+  if(shell == "fish")
+    return fmt::format(
+      "complete -c {0} -a '(env {1}=1 {0} (commandline -opc)[2..-1] (commandline -ct) 2>/dev/null)'\n",
+      program, completion_variable);
+  throw std::invalid_argument("completion_script: unknown shell: " + std::string(shell));
+}
+
+} // namespace kuri::option
@@ -0,0 +1,55 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+///
+/// @file
+/// @brief Forward declarations of the classes of the library.
+///
+/// @details
+///   Include this header instead of `Program.hh` in headers and translation
+///   units which only pass the objects of the library around by reference or
+///   pointer.  It includes nothing but the definitions of `args_t` and
+///   `option_id`.
+///
+
+#include "parse_args.hh"
+
+namespace kuri::option
+{
+enum class error_code;
+class argument_error;
+class ArgStream;
+class ChromeTrace;
+template<typename Context>
+class Commands;
+class ConfigFile;
+class Error;
+class Instrumentation;
+class MappedFile;
+class Nearest;
+class Option;
+struct OptionSpec;
+template<typename T>
+class ParseCache;
+class ParseResult;
+class Plugin;
+class Program;
+class Schema;
+class SchemaRegistry;
+class StringPool;
+struct cache_stats_t;
+class usage_error;
+} // namespace kuri::option
@@ -0,0 +1,233 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KURI_OPTION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace kuri::option
+{
+namespace detail
+{
+///
+/// @brief Counts the occurrences of a character in a string.
+///
+/// @details
+///   Compares 16 characters at a time with SSE2 when it's available and one
+///   at a time otherwise, and for the last few characters.
+///
+/// @param s The string.
+/// @param c The character to count.
+/// @return The number of occurrences.
+///
+inline std::size_t count(std::string_view s, char c) noexcept
+{
+  std::size_t n = 0;
+  std::size_t i = 0;
+#if defined(KURI_OPTION_SSE2)
+  const auto needle = _mm_set1_epi8(c);
+  for(; i + 16 <= s.size(); i += 16)
+  {
+    auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+#if defined(__GNUC__)
+    n += static_cast<std::size_t>(__builtin_popcount(mask));
+#else
+    for(; mask != 0; mask &= mask - 1)
+      ++n;
+#endif
+  }
+#endif
+  for(; i < s.size(); ++i)
+    n += s[i] == c ? 1 : 0;
+  return n;
+}
+
+///
+/// @brief Parses a plain decimal floating point number.
+///
+/// @details
+///   Handles numbers without an exponent whose digits, ignoring the
+///   decimal point, form an integer exactly representable in `T` and
+///   whose fraction has at most as many digits as the largest power of
+///   ten exactly representable in `T`.  Dividing the two exact values
+///   then gives the correctly rounded result, the same as
+///   `std::from_chars`.  Anything else is left to the caller.
+///
+/// @param first, last The range of characters.
+/// @param value Set to the number parsed.
+/// @return The first character after the number, or null if the number
+///   isn't handled.
+///
+template<typename T>
+const char* parse_decimal(const char* first, const char* last, T& value) noexcept
+{
+  static constexpr T powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+    1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  // The largest power of ten exactly representable in float is 1e10.
+  constexpr std::size_t max_fraction = std::is_same_v<T, float> ? 10 : 22;
+  auto p = first;
+  bool negative = p != last && *p == '-';
+  if(negative)
+    ++p;
+  unsigned long long mantissa = 0;
+  std::size_t digits = 0;
+  std::size_t fraction = 0;
+  for(; p != last && *p >= '0' && *p <= '9'; ++p, ++digits)
+    mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+  if(p != last && *p == '.')
+    for(++p; p != last && *p >= '0' && *p <= '9'; ++p, ++digits, ++fraction)
+      mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+  // 19 digits always fit in an unsigned long long.
+  if(digits == 0 || digits > 19 || fraction > max_fraction
+    || mantissa > (1ULL << std::numeric_limits<T>::digits) || (p != last && (*p == 'e' || *p == 'E')))
+    return nullptr;
+  value = static_cast<T>(mantissa) / powers[fraction];
+  if(negative)
+    value = -value;
+  return p;
+}
+
+///
+/// @brief Parses a number at the start of a range of characters.
+///
+/// @details
+///   Uses `std::from_chars`.  Plain decimal `float` and `double` numbers
+///   are first tried with `parse_decimal`, which is faster than the
+///   floating point `std::from_chars` of some standard libraries.
+///   Floating point numbers are parsed with the
+///   `std::stof` family of functions if the standard library lacks the
+///   floating point overloads of `std::from_chars`.  Those also accept
+///   leading white space, a plus sign, and hexadecimal numbers, which are
+///   rejected first to accept the same numbers as `std::from_chars`.
+///
+/// @param first, last The range of characters.
+/// @param delim The delimiter ending the number.
+/// @param value Set to the number parsed.
+/// @return The first character after the number, or null if there is no
+///   number or it's out of range for the type.
+///
+template<typename T>
+const char* parse_number(const char* first, const char* last, char delim, T& value)
+{
+  if constexpr(std::is_same_v<T, float> || std::is_same_v<T, double>)
+  {
+    if(auto next = parse_decimal(first, last, value); next != nullptr)
+      return next;
+  }
+#if !defined(__cpp_lib_to_chars)
+  if constexpr(std::is_floating_point_v<T>)
+  {
+    auto digits = first != last && *first == '-' ? first + 1 : first;
+    if(digits == last)
+      return nullptr;
+    auto c = std::tolower(static_cast<unsigned char>(*digits));
+    if(!(std::isdigit(c) || c == '.' || c == 'i' || c == 'n')
+      || (c == '0' && last - digits > 1 && std::tolower(static_cast<unsigned char>(digits[1])) == 'x'))
+      return nullptr;
+    std::string s(first, std::find(first, last, delim));
+    std::size_t pos = 0;
+    try
+    {
+      if constexpr(std::is_same_v<T, float>)
+        value = std::stof(s, &pos);
+      else if constexpr(std::is_same_v<T, double>)
+        value = std::stod(s, &pos);
+      else
+        value = std::stold(s, &pos);
+    }
+    catch(const std::logic_error&)
+    {
+      return nullptr;
+    }
+    return first + pos;
+  }
+  else
+#endif
+  {
+    (void)delim;
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc() ? ptr : nullptr;
+  }
+}
+} // namespace detail
+
+///
+/// @brief Parses a list of numbers separated by a delimiter.
+///
+/// @details
+///   Meant for option values holding long lists of numbers, such as
+///   `--ids=17,42,...`.  The delimiters are counted first so the vector is
+///   allocated once, then each number is converted in place without
+///   creating temporary strings.  The numbers may not have a leading plus
+///   sign or surrounding spaces.  An empty string is an empty list.
+///
+/// @code
+///   std::vector<int> ids;
+///   program.optional("--ids", [&ids](const Option& o) { ids = numeric_list<int>(o.value); });
+/// @endcode
+///
+/// @tparam T
+///   The integer or floating point type of the numbers.
+/// @param s
+///   The list of numbers.
+/// @param delim
+///   The delimiter between the numbers.
+/// @param limit
+///   The maximum number of elements.  A longer list throws a
+///   `std::runtime_error` exception before any memory is allocated.
+///
+/// @return The numbers in the order they appear in the list.
+///
+template<typename T>
+std::vector<T> numeric_list(
+  std::string_view s, char delim = ',', std::size_t limit = std::numeric_limits<std::size_t>::max())
+{
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "numeric_list: T must be a number type");
+  std::vector<T> result;
+  if(s.empty())
+    return result;
+  auto size = detail::count(s, delim) + 1;
+  if(size > limit)
+    throw std::runtime_error("list too long: " + std::to_string(size) + " elements");
+  result.resize(size);
+  const char* first = s.data();
+  const char* last = first + s.size();
+  for(auto& value: result)
+  {
+    auto next = detail::parse_number(first, last, delim, value);
+    if(next == nullptr || next == first || (next != last && *next != delim))
+      throw std::runtime_error("bad number: " + std::string(first, std::find(first, last, delim)));
+    // The delimiters were counted so only the last number ends at the end.
+    first = next == last ? last : next + 1;
+  }
+  return result;
+}
+
+} // namespace kuri::option
@@ -0,0 +1,89 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// C++20 module interface of the library.  Built when configuring with
+// -DOPTION_MODULE=ON and used with `import kuri.option;`.  The headers are
+// included in the global module fragment so the module and the headers can
+// be used in the same program.
+//
+
+module;
+
+#include "ArgStream.hh"
+#include "Commands.hh"
+#include "ConfigFile.hh"
+#include "Instrumentation.hh"
+#include "MappedFile.hh"
+#include "Option.hh"
+#include "ParseResult.hh"
+#include "Plugin.hh"
+#include "ParseCache.hh"
+#include "Program.hh"
+#include "Schema.hh"
+#include "SchemaRegistry.hh"
+#include "StringPool.hh"
+#include "cache_stats.hh"
+#include "completion.hh"
+#include "numeric_list.hh"
+#include "parallel.hh"
+#include "parse_args.hh"
+#include "string_functions.hh"
+#include "suggest.hh"
+#include "usage.hh"
+
+export module kuri.option;
+
+export namespace kuri::option
+{
+using kuri::option::args_t;
+using kuri::option::option_id;
+
+using kuri::option::ArgStream;
+using kuri::option::ChromeTrace;
+using kuri::option::Commands;
+using kuri::option::ConfigFile;
+using kuri::option::Error;
+using kuri::option::Instrumentation;
+using kuri::option::MappedFile;
+using kuri::option::Nearest;
+using kuri::option::Option;
+using kuri::option::OptionSpec;
+using kuri::option::ParseCache;
+using kuri::option::ParseResult;
+using kuri::option::Plugin;
+using kuri::option::Program;
+using kuri::option::Schema;
+using kuri::option::SchemaRegistry;
+using kuri::option::StringPool;
+using kuri::option::argument_error;
+using kuri::option::cache_stats_t;
+using kuri::option::error_code;
+using kuri::option::usage_error;
+
+using kuri::option::basename;
+using kuri::option::completion_requested;
+using kuri::option::completion_script;
+using kuri::option::completion_variable;
+using kuri::option::did_you_mean;
+using kuri::option::edit_distance;
+using kuri::option::fnv1a;
+using kuri::option::instrumented;
+using kuri::option::numeric_list;
+using kuri::option::numeric_range;
+using kuri::option::parallel_for;
+using kuri::option::split_string;
+using kuri::option::starts_with;
+using kuri::option::usage;
+} // namespace kuri::option
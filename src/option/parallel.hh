@@ -0,0 +1,118 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kuri::option
+{
+///
+/// @brief Calls a function for each index in the range [0, n) using up to
+///   `concurrency` threads.
+///
+/// @details
+///   The calling thread takes part in the work.  Each thread repeatedly
+///   claims the next unprocessed index so that threads finishing early pick up
+///   the remaining work.  Indices are claimed in increasing order.
+///
+///   If a call throws an exception no index greater than the failing one is
+///   started.  Calls for lower indices are always completed and once all
+///   threads have finished the exception from the lowest failing index is
+///   rethrown.  The result is the same exception as would have been thrown
+///   by calling the function sequentially.  If a thread can't be started
+///   the threads already started finish their current calls and the
+///   exception from starting the thread is rethrown.
+///
+/// @param n
+///   The number of indices.
+/// @param concurrency
+///   The maximum number of threads.  Zero means the number of hardware
+///   threads and one means the function is called sequentially in the
+///   calling thread.
+/// @param f
+///   The function called with each index.
+///
+template<typename F>
+void parallel_for(std::size_t n, unsigned concurrency, F f)
+{
+  if(concurrency == 0)
+    concurrency = std::max(std::thread::hardware_concurrency(), 1U);
+  if(concurrency == 1 || n <= 1)
+  {
+    for(std::size_t i = 0; i < n; ++i)
+      f(i);
+    return;
+  }
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::size_t> failed{n};
+  std::mutex mutex;
+  std::exception_ptr error;
+  auto worker = [&]() {
+    for(auto i = next++; i < n && i < failed; i = next++)
+    {
+      try
+      {
+        f(i);
+      }
+      catch(...)
+      {
+        std::lock_guard lock(mutex);
+        if(i < failed)
+        {
+          failed = i;
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+  {
+    // Joins the started threads on every way out of this block.  Destroying
+    // a joinable thread calls std::terminate, which would happen if starting
+    // one of the threads throws.
+    struct joining_t
+    {
+      std::vector<std::thread> threads;
+      ~joining_t()
+      {
+        for(auto& t: threads)
+          t.join();
+      }
+    } joining;
+    auto count = std::min(static_cast<std::size_t>(concurrency), n) - 1;
+    try
+    {
+      joining.threads.reserve(count);
+      for(std::size_t i = 0; i < count; ++i)
+        joining.threads.emplace_back(worker);
+    }
+    catch(...)
+    {
+      // Keep the threads already started from claiming more indices.
+      failed = 0;
+      throw;
+    }
+    worker();
+  }
+  if(error)
+    std::rethrow_exception(error);
+}
+
+} // namespace kuri::option
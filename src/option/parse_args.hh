@@ -1,4 +1,4 @@
-// Copyright 2021 Krister Joas
+// Copyright 2021, 2026 Krister Joas
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <utility>
 #include <string>
 #include <vector>
@@ -21,5 +22,7 @@
 namespace kuri::option
 {
 using args_t = std::vector<std::string>;
+/// @brief Dense identifier of an option name assigned by `Program`.
+using option_id = std::size_t;
 
 } // namespace kuri::option
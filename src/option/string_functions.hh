@@ -1,4 +1,4 @@
-// Copyright 2021 Krister Joas
+// Copyright 2021, 2026 Krister Joas
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -14,12 +14,20 @@
 
 #pragma once
 
-#include <filesystem>
+#include <cstdint>
+#include <limits>
 #include <set>
-#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "compiled.hh"
+
+#if KURI_OPTION_DEFINITIONS
+#include <filesystem>
+#include <stdexcept>
+#endif
+
 namespace kuri::option
 {
 ///
@@ -42,27 +50,7 @@ namespace kuri::option
 /// @return A vector of strings split at the delimiter.  If `include_empties`
 ///   is true then the vector may contain empty strings.
 ///
-inline std::vector<std::string> split_string(const std::string& s, char delim, bool include_empties = false)
-{
-  std::vector<std::string> result;
-  std::string item;
-  for(auto& i: s)
-  {
-    if(i == delim)
-    {
-      if(include_empties || !item.empty())
-      {
-        result.push_back(item);
-        item.clear();
-      }
-    }
-    else
-      item.push_back(i);
-  }
-  if(include_empties || !item.empty())
-    result.push_back(item);
-  return result;
-}
+KURI_OPTION_INLINE std::vector<std::string> split_string(const std::string& s, char delim, bool include_empties = false);
 
 ///
 /// @brief Parse a string which contains a description of a set of numbers.
@@ -79,28 +67,56 @@ inline std::vector<std::string> split_string(const std::string& s, char delim, b
 ///   The minimum number allowed.  Used to handle the open ended `-n` case.
 /// @param max
 ///   The maximum number allowed.  Used to handle the open ended `n-` case.
+/// @param limit
+///   The maximum number of elements of the set.  A description expanding
+///   to more elements throws a `std::runtime_error` exception.  A range
+///   larger than the limit is rejected before its elements are generated,
+///   so the time spent is bounded by the length of the description times
+///   the limit.
 ///
 /// @return A set of integers defined by the range.
 ///
-inline std::set<int> numeric_range(const std::string& s, int min, int max)
+KURI_OPTION_INLINE std::set<int> numeric_range(
+  const std::string& s, int min, int max, std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+///
+/// @brief Returns true if a string starts with a prefix.
+///
+/// @param s
+///   The string.
+/// @param prefix
+///   The prefix.
+///
+/// @return True if `s` starts with `prefix`.
+///
+inline bool starts_with(std::string_view s, std::string_view prefix) noexcept
 {
-  std::set<int> result;
-  auto comma_ranges = split_string(s, ',');
-  for(auto i: comma_ranges)
+  return s.substr(0, prefix.size()) == prefix;
+}
+
+///
+/// @brief Computes the 64 bit FNV-1a hash of a string.
+///
+/// @details
+///   The hash is stable across processes and platforms which makes it
+///   suitable for hash tables stored in files.  Passing the result of a
+///   previous call as the seed continues the hash over several strings.
+///
+/// @param s
+///   The string to hash.
+/// @param seed
+///   The initial hash value.
+///
+/// @return The hash value.
+///
+inline std::uint64_t fnv1a(std::string_view s, std::uint64_t seed = 14695981039346656037ULL) noexcept
+{
+  for(auto c: s)
   {
-    auto dash_ranges = split_string(i, '-', true);
-    if(dash_ranges.size() > 2)
-      throw std::runtime_error("bad range: " + s);
-    auto first = dash_ranges[0].empty() ? min : std::stoi(dash_ranges[0]);
-    if(dash_ranges.size() == 2)
-    {
-      auto last = dash_ranges[1].empty() ? max : std::stoi(dash_ranges[1]);
-      for(; first <= last; ++first) result.insert(first);
-    }
-    else
-      result.insert(first);
+    seed ^= static_cast<unsigned char>(c);
+    seed *= 1099511628211ULL;
   }
-  return result;
+  return seed;
 }
 
 ///
@@ -116,10 +132,65 @@ inline std::set<int> numeric_range(const std::string& s, int min, int max)
 ///   A string containing a path.
 /// @return The basename, i.e. the filename of the path.
 ///
-inline std::string basename(const std::string& path)
+KURI_OPTION_INLINE std::string basename(const std::string& path);
+
+#if KURI_OPTION_DEFINITIONS
+
+KURI_OPTION_INLINE std::vector<std::string> split_string(const std::string& s, char delim, bool include_empties)
+{
+  std::vector<std::string> result;
+  std::string item;
+  for(auto& i: s)
+  {
+    if(i == delim)
+    {
+      if(include_empties || !item.empty())
+      {
+        result.push_back(item);
+        item.clear();
+      }
+    }
+    else
+      item.push_back(i);
+  }
+  if(include_empties || !item.empty())
+    result.push_back(item);
+  return result;
+}
+
+KURI_OPTION_INLINE std::set<int> numeric_range(const std::string& s, int min, int max, std::size_t limit)
+{
+  std::set<int> result;
+  auto comma_ranges = split_string(s, ',');
+  for(auto i: comma_ranges)
+  {
+    auto dash_ranges = split_string(i, '-', true);
+    if(dash_ranges.size() > 2)
+      throw std::runtime_error("bad range: " + s);
+    auto first = dash_ranges[0].empty() ? min : std::stoi(dash_ranges[0]);
+    auto last = first;
+    if(dash_ranges.size() == 2)
+      last = dash_ranges[1].empty() ? max : std::stoi(dash_ranges[1]);
+    if(first > last)
+      continue;
+    // Computed in 64 bits since the range may span all ints.
+    if(static_cast<std::uint64_t>(static_cast<std::int64_t>(last) - first) >= limit)
+      throw std::runtime_error("range too large: " + s);
+    for(auto n = first; n < last; ++n)
+      result.insert(n);
+    result.insert(last);
+    if(result.size() > limit)
+      throw std::runtime_error("range too large: " + s);
+  }
+  return result;
+}
+
+KURI_OPTION_INLINE std::string basename(const std::string& path)
 {
   std::filesystem::path p(path);
   return p.filename().string();
 }
 
+#endif
+
 } // namespace kuri::option
@@ -0,0 +1,26 @@
+// Copyright 2026 Krister Joas
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// A plugin used by the tests of plugin commands.
+//
+
+#include <iterator>
+
+#include "parse_args.hh"
+
+extern "C" void test_plugin(int& context, kuri::option::args_t::iterator first, kuri::option::args_t::iterator last)
+{
+  context = 100 + static_cast<int>(std::distance(first, last));
+}